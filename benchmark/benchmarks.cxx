@@ -0,0 +1,279 @@
+// maze benchmarks: generate, solve and to_string over a sweep of sizes and seeds.
+//
+// usage: benchmarks [ sizes ( default: 101,1001,4001 ) ] [ seeds ( default: 3 ) ]
+//
+// one CSV row per run to stdout:
+//   benchmark, algorithm, packing, size, seed,
+//   seconds, cells_per_second, peak_heap_bytes, allocations, max_rss_kib,
+//   expanded, pushes, pops, max_frontier, path_length
+// the timings are of the default ( stats::disabled_t ) types,
+// the counters are of a second run with stats::enabled_t.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined( __unix__ ) or defined( __APPLE__ )
+  #include <sys/resource.h>
+  #define WONDERLAND_MAZE_HAS_GETRUSAGE
+#endif
+
+#include <wonder_rabbit_project/wonderland/maze.hxx>
+
+namespace
+{
+  // allocation counters of the global operator new below
+  std::atomic< std::size_t > allocations( 0 );
+  std::atomic< std::size_t > heap_bytes( 0 );
+  std::atomic< std::size_t > peak_heap_bytes( 0 );
+  
+  // the size of an allocation is kept in front of it; a max_align_t sized header keeps the alignment
+  constexpr auto header_size = sizeof( std::max_align_t ) > sizeof( std::size_t ) ? sizeof( std::max_align_t ) : sizeof( std::size_t );
+  
+  auto allocate( const std::size_t size ) noexcept
+    -> void*
+  {
+    const auto p = static_cast< char* >( std::malloc( header_size + size ) );
+    
+    if ( not p )
+      return nullptr;
+    
+    *reinterpret_cast< std::size_t* >( p ) = size;
+    
+    ++allocations;
+    
+    const auto live = heap_bytes += size;
+    
+    auto peak = peak_heap_bytes.load();
+    while ( live > peak and not peak_heap_bytes.compare_exchange_weak( peak, live ) )
+      ;
+    
+    return p + header_size;
+  }
+  
+  auto deallocate( void* p ) noexcept
+    -> void
+  {
+    if ( not p )
+      return;
+    
+    const auto q = static_cast< char* >( p ) - header_size;
+    
+    heap_bytes -= *reinterpret_cast< std::size_t* >( q );
+    
+    std::free( q );
+  }
+  
+  auto allocate_or_throw( const std::size_t size )
+    -> void*
+  {
+    if ( const auto p = allocate( size ) )
+      return p;
+    throw std::bad_alloc();
+  }
+}
+
+auto operator new  ( std::size_t size ) -> void* { return allocate_or_throw( size ); }
+auto operator new[]( std::size_t size ) -> void* { return allocate_or_throw( size ); }
+auto operator new  ( std::size_t size, const std::nothrow_t& ) noexcept -> void* { return allocate( size ); }
+auto operator new[]( std::size_t size, const std::nothrow_t& ) noexcept -> void* { return allocate( size ); }
+auto operator delete  ( void* p ) noexcept -> void { deallocate( p ); }
+auto operator delete[]( void* p ) noexcept -> void { deallocate( p ); }
+auto operator delete  ( void* p, const std::nothrow_t& ) noexcept -> void { deallocate( p ); }
+auto operator delete[]( void* p, const std::nothrow_t& ) noexcept -> void { deallocate( p ); }
+
+namespace
+{
+  using namespace wonder_rabbit_project::wonderland;
+  
+  using generator_t       = maze::generator::generator_2d_t<>;
+  using stats_generator_t = maze::generator::generator_2d_t< generator_t::rng_t, generator_t::size_t, maze::stats::enabled_t >;
+  using solver_t          = maze::solver::solver_2d_t<>;
+  using stats_solver_t    = maze::solver::solver_2d_t< solver_t::size_t, maze::stats::enabled_t >;
+  
+  struct measure_t
+  {
+    double      seconds;
+    std::size_t peak_heap_bytes;
+    std::size_t allocations;
+  };
+  
+  // peak_heap_bytes is the peak over the bytes live before f
+  template < class T_function >
+  auto measure( const T_function& f )
+    -> measure_t
+  {
+    const auto base_allocations = allocations.load();
+    const auto base_heap_bytes  = heap_bytes.load();
+    
+    peak_heap_bytes = base_heap_bytes;
+    
+    const auto begin = std::chrono::steady_clock::now();
+    
+    f();
+    
+    const auto end = std::chrono::steady_clock::now();
+    
+    return
+      { std::chrono::duration< double >( end - begin ).count()
+      , peak_heap_bytes.load() - base_heap_bytes
+      , allocations.load() - base_allocations
+      };
+  }
+  
+  auto max_rss_kib( )
+    -> long
+  {
+#ifdef WONDERLAND_MAZE_HAS_GETRUSAGE
+    rusage u;
+    if ( getrusage( RUSAGE_SELF, &u ) == 0 )
+#ifdef __APPLE__
+      return u.ru_maxrss / 1024;
+#else
+      return u.ru_maxrss;
+#endif
+#endif
+    return -1;
+  }
+  
+  auto to_string( const maze::packing p )
+    -> std::string
+  { return p == maze::packing::byte ? "byte" : "bit"; }
+  
+  struct row_t
+  {
+    std::string   benchmark;
+    std::string   algorithm;
+    maze::packing packing;
+    std::size_t   size;
+    std::uint64_t seed;
+    measure_t     m;
+    
+    std::size_t expanded, pushes, pops, max_frontier, path_length;
+  };
+  
+  auto print_header( )
+    -> void
+  {
+    std::cout
+      << "benchmark,algorithm,packing,size,seed,"
+         "seconds,cells_per_second,peak_heap_bytes,allocations,max_rss_kib,"
+         "expanded,pushes,pops,max_frontier,path_length\n"
+      ;
+  }
+  
+  auto print( const row_t& r )
+    -> void
+  {
+    const auto cells = double( r.size ) * double( r.size );
+    
+    std::cout
+      << r.benchmark << ','
+      << r.algorithm << ','
+      << to_string( r.packing ) << ','
+      << r.size << ','
+      << r.seed << ','
+      << r.m.seconds << ','
+      << ( r.m.seconds > 0 ? cells / r.m.seconds : 0 ) << ','
+      << r.m.peak_heap_bytes << ','
+      << r.m.allocations << ','
+      << max_rss_kib() << ','
+      << r.expanded << ','
+      << r.pushes << ','
+      << r.pops << ','
+      << r.max_frontier << ','
+      << r.path_length << '\n'
+      << std::flush
+      ;
+  }
+  
+  template < class T_stats >
+  auto set_stats( row_t& r, const T_stats& s )
+    -> void
+  {
+    r.expanded     = s.expanded;
+    r.pushes       = s.pushes;
+    r.pops         = s.pops;
+    r.max_frontier = s.max_frontier;
+    r.path_length  = s.path_length;
+  }
+  
+  auto parse_sizes( const std::string& s )
+    -> std::vector< std::size_t >
+  {
+    std::vector< std::size_t > r;
+    std::stringstream ss( s );
+    std::string item;
+    
+    while ( std::getline( ss, item, ',' ) )
+      r.emplace_back( std::stoull( item ) | 1 );
+    
+    return r;
+  }
+  
+  auto run( const std::size_t size, const std::uint64_t seed, const maze::packing packing )
+    -> void
+  {
+    const auto rng = std::make_shared< generator_t::rng_t >();
+    
+    for ( const auto a : { maze::generator::algorithm::drill, maze::generator::algorithm::eller } )
+    {
+      auto g = std::make_shared< generator_t >();
+      g -> rng( rng ) -> size( generator_t::size_t( size ) ) -> algorithm( a ) -> packing( packing );
+      
+      rng -> seed( generator_t::rng_t::result_type( seed ) );
+      
+      row_t r { "generate", maze::to_string( a ), packing, size, seed, measure( [ &g ]{ g -> generate(); } ), 0, 0, 0, 0, 0 };
+      
+      auto sg = std::make_shared< stats_generator_t >();
+      sg -> rng( rng ) -> size( generator_t::size_t( size ) ) -> algorithm( a ) -> packing( packing );
+      rng -> seed( generator_t::rng_t::result_type( seed ) );
+      sg -> generate();
+      set_stats( r, sg -> stats() );
+      
+      print( r );
+      
+      if ( a != maze::generator::algorithm::drill )
+        continue;
+      
+      const auto data = g -> data();
+      
+      for ( const auto s : { maze::solver::algorithm::dijkstra, maze::solver::algorithm::a_star } )
+      {
+        auto solver = std::make_shared< solver_t >();
+        solver -> algorithm( s ) -> load( data );
+        
+        row_t rs { "solve", maze::to_string( s ), packing, size, seed, measure( [ &solver ]{ solver -> solve(); } ), 0, 0, 0, 0, 0 };
+        
+        auto stats_solver = std::make_shared< stats_solver_t >();
+        stats_solver -> algorithm( s ) -> load( data ) -> solve();
+        set_stats( rs, stats_solver -> stats() );
+        
+        print( rs );
+      }
+      
+      std::string text;
+      row_t t { "to_string", "", packing, size, seed, measure( [ &g, &text ]{ text = g -> to_string(); } ), 0, 0, 0, 0, 0 };
+      print( t );
+    }
+  }
+}
+
+int main( int number_of_parameters, char** parameters )
+{
+  const auto sizes = parse_sizes( number_of_parameters > 1 ? parameters[ 1 ] : "101,1001,4001" );
+  const auto seeds = number_of_parameters > 2 ? std::stoull( parameters[ 2 ] ) : 3;
+  
+  print_header();
+  
+  for ( const auto size : sizes )
+    for ( const auto packing : { maze::packing::byte, maze::packing::bit } )
+      for ( std::uint64_t seed = 0; seed < seeds; ++seed )
+        run( size, seed, packing );
+}
@@ -51,6 +51,10 @@ int main( int number_of_parameters, char** parameters )
          -> algorithm( solver_algorithm )
          -> solve()
          -> to_string()
+    << "\n"
+       "[ answer ]\n\n"
+    << std::make_shared< maze::renderer_2d_t<> >()
+         -> to_string( *s -> data(), s -> answer().get() )
     ;
   
 }
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "traits.hxx"
+#include "thread_pool.hxx"
+#include "generator_2d.hxx"
+#include "solver_2d.hxx"
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      // generates ( and solves ) many independent mazes on a thread pool, the workers pull the jobs from a shared counter.
+      // the job n uses its own rng seeded with split_mix_64( seed, n ),
+      // so the results do not depend on the number of threads.
+      // each worker keeps its own generator and solver, their buffers are reused between the jobs.
+      template
+      < class T_rng  = std::conditional< sizeof( void* ) == 8, std::mt19937_64  , std::mt19937      >::type
+      , class T_size = std::int_fast32_t
+      >
+      class batch_2d_t
+        : public std::enable_shared_from_this
+          < batch_2d_t
+            < T_rng
+            , T_size
+            >
+          >
+      {
+      public:
+        using rng_t  = T_rng;
+        using size_t = T_size;
+        
+        using shared_t = std::shared_ptr< batch_2d_t >;
+        
+        using generator_t = generator::generator_2d_t< rng_t, size_t >;
+        using solver_t    = solver::solver_2d_t< size_t >;
+        
+        using data_t          = typename generator_t::data_t;
+        using shared_data_t   = typename generator_t::shared_data_t;
+        using answer_t        = typename solver_t::answer_t;
+        using shared_answer_t = typename solver_t::shared_answer_t;
+        
+        struct result_t
+        {
+          std::size_t     index;
+          std::uint64_t   seed;
+          shared_data_t   data;
+          shared_answer_t answer;
+        };
+        
+        // called on the worker threads, maybe at the same time.
+        // data and answer are the worker's buffers, valid only in the call.
+        using callback_t = std::function< auto ( const result_t& result ) -> void >;
+      
+      private:
+        std::size_t   _count;
+        size_t        _width;
+        size_t        _height;
+        std::uint64_t _seed;
+        std::size_t   _threads;
+        bool          _solve;
+        bool          _keep_data;
+        
+        generator::algorithm _generator_algorithm;
+        solver::algorithm    _solver_algorithm;
+        maze::packing        _packing;
+        
+        struct worker_t
+        {
+          typename generator_t::shared_t generator;
+          typename solver_t::shared_t    solver;
+          std::shared_ptr< rng_t >       rng;
+        };
+        
+        auto make_workers( const std::size_t n ) const
+          -> std::vector< worker_t >
+        {
+          std::vector< worker_t > r( n );
+          
+          for ( auto& w : r )
+          {
+            w.rng       = std::make_shared< rng_t >();
+            w.generator = std::make_shared< generator_t >();
+            w.solver    = std::make_shared< solver_t >();
+            
+            w.generator
+              -> rng( w.rng )
+              -> width( _width )
+              -> height( _height )
+              -> algorithm( _generator_algorithm )
+              -> packing( _packing )
+              ;
+            
+            w.solver -> algorithm( _solver_algorithm );
+          }
+          
+          return r;
+        }
+        
+        auto run_job( worker_t& w, const std::size_t index, const callback_t& f ) const
+          -> void
+        {
+          const auto seed = job_seed( _seed, index );
+          
+          w.rng -> seed( typename rng_t::result_type( seed ) );
+          
+          // release the last data from the solver to reuse its buffer in the generator
+          w.solver -> unload();
+          
+          result_t r { index, seed, w.generator -> generate() -> data(), nullptr };
+          
+          if ( _solve )
+            r.answer = w.solver -> load( r.data ) -> solve() -> answer();
+          
+          f( r );
+        }
+      
+      public:
+        
+        batch_2d_t()
+          : _count( 1 )
+          , _width( generator_t::default_size )
+          , _height( generator_t::default_size )
+          , _seed( 0 )
+          , _threads( 0 )
+          , _solve( true )
+          , _keep_data( true )
+          , _generator_algorithm( generator::algorithm::drill )
+          , _solver_algorithm( solver::algorithm::dijkstra )
+          , _packing( maze::packing::byte )
+        { }
+        
+        static auto job_seed( const std::uint64_t seed, const std::size_t index )
+          -> std::uint64_t
+        { return split_mix_64( seed, index ); }
+        
+        auto count( const std::size_t n )
+          -> shared_t
+        {
+          _count = n;
+          return this -> shared_from_this();
+        }
+        
+        auto size( const size_t size_ )
+          -> shared_t
+        { return this -> width( size_ ) -> height( size_ ); }
+        
+        auto width( const size_t width_ )
+          -> shared_t
+        {
+          _width = width_;
+          return this -> shared_from_this();
+        }
+        
+        auto height( const size_t height_ )
+          -> shared_t
+        {
+          _height = height_;
+          return this -> shared_from_this();
+        }
+        
+        auto seed( const std::uint64_t s )
+          -> shared_t
+        {
+          _seed = s;
+          return this -> shared_from_this();
+        }
+        
+        // 0: std::thread::hardware_concurrency()
+        auto threads( const std::size_t n )
+          -> shared_t
+        {
+          _threads = n;
+          return this -> shared_from_this();
+        }
+        
+        auto solve( const bool enable = true )
+          -> shared_t
+        {
+          _solve = enable;
+          return this -> shared_from_this();
+        }
+        
+        // false: run() returns only the seeds and the answers
+        auto keep_data( const bool enable = true )
+          -> shared_t
+        {
+          _keep_data = enable;
+          return this -> shared_from_this();
+        }
+        
+        auto generator_algorithm( const generator::algorithm a )
+          -> shared_t
+        {
+          _generator_algorithm = a;
+          return this -> shared_from_this();
+        }
+        
+        auto solver_algorithm( const solver::algorithm a )
+          -> shared_t
+        {
+          _solver_algorithm = a;
+          return this -> shared_from_this();
+        }
+        
+        auto packing( const maze::packing p )
+          -> shared_t
+        {
+          _packing = p;
+          return this -> shared_from_this();
+        }
+        
+        auto run( const callback_t& f )
+          -> shared_t
+        {
+          thread_pool_t pool( _threads );
+          
+          auto workers = make_workers( pool.size() );
+          
+          // one task per worker pulls the jobs from the shared counter,
+          // no task ( and no std::function ) is allocated per job
+          std::atomic< std::size_t > next( 0 );
+          
+          for ( std::size_t n = 0; n < pool.size(); ++n )
+            pool.submit
+            ( [ this, &workers, &f, &next ]( const std::size_t worker )
+              {
+                for ( auto index = next++; index < _count; index = next++ )
+                  run_job( workers[ worker ], index, f );
+              }
+            );
+          
+          pool.wait();
+          
+          return this -> shared_from_this();
+        }
+        
+        // the results in the order of the jobs, with their own copies of the data and the answers
+        auto run( )
+          -> std::vector< result_t >
+        {
+          std::vector< result_t > results( _count );
+          
+          run
+          ( [ this, &results ]( const result_t& r )
+            {
+              auto& to = results[ r.index ];
+              
+              to.index = r.index;
+              to.seed  = r.seed;
+              
+              if ( _keep_data )
+                to.data = std::make_shared< data_t >( *r.data );
+              
+              if ( r.answer )
+                to.answer = std::make_shared< answer_t >( *r.answer );
+            }
+          );
+          
+          return results;
+        }
+      };
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      namespace solver
+      {
+        // monotone bucket queue for small integer keys.
+        // a pushed key must be in [ the last popped key, the last popped key + max_step ],
+        // it is true for A* with a consistent heuristic on unit cost grids ( max_step = 2 ).
+        // the buckets are circular and keep their capacity over reset().
+        template
+        < class T_value = std::size_t
+        >
+        class bucket_queue_t
+        {
+        public:
+          using value_t = T_value;
+        
+        private:
+          std::vector< std::vector< value_t > > _buckets;
+          
+          std::size_t _key;
+          std::size_t _size;
+        
+        public:
+          
+          bucket_queue_t( const std::size_t max_step = 1 )
+          { reset( max_step ); }
+          
+          auto reset( const std::size_t max_step, const std::size_t key = 0 )
+            -> void
+          {
+            _buckets.resize( max_step + 1 );
+            
+            for ( auto& bucket : _buckets )
+              bucket.clear();
+            
+            _key  = key;
+            _size = 0;
+          }
+          
+          auto push( const std::size_t key, const value_t& value )
+            -> void
+          {
+            if ( key < _key or key >= _key + _buckets.size() )
+              throw std::logic_error( "bucket queue key is out of range." );
+            
+            _buckets[ key % _buckets.size() ].push_back( value );
+            ++_size;
+          }
+          
+          // LIFO in a same key, it prefers the last pushed ( deeper ) nodes.
+          auto pop( std::size_t& key, value_t& value )
+            -> bool
+          {
+            if ( _size == 0 )
+              return false;
+            
+            while ( _buckets[ _key % _buckets.size() ].empty() )
+              ++_key;
+            
+            auto& bucket = _buckets[ _key % _buckets.size() ];
+            
+            key   = _key;
+            value = bucket.back();
+            
+            bucket.pop_back();
+            --_size;
+            
+            return true;
+          }
+          
+          auto size( ) const
+            -> std::size_t
+          { return _size; }
+          
+          auto empty( ) const
+            -> bool
+          { return _size == 0; }
+        };
+      }
+    }
+  }
+}
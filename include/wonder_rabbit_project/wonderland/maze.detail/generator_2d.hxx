@@ -4,13 +4,18 @@
 #include <memory>
 #include <random>
 #include <type_traits>
-#include <sstream>
 #include <algorithm>
 #include <vector>
+#include <array>
+#include <functional>
+#include <ostream>
 
 #include <glm/glm.hpp>
 
 #include "traits.hxx"
+#include "grid_2d.hxx"
+#include "renderer_2d.hxx"
+#include "stats.hxx"
 
 namespace wonder_rabbit_project
 {
@@ -21,20 +26,23 @@ namespace wonder_rabbit_project
       namespace generator
       {
         template
-        < class T_rng  = std::conditional< sizeof( void* ) == 8, std::mt19937_64  , std::mt19937      >::type
-        , class T_size = std::int_fast32_t
+        < class T_rng   = std::conditional< sizeof( void* ) == 8, std::mt19937_64  , std::mt19937      >::type
+        , class T_size  = std::int_fast32_t
+        , class T_stats = maze::stats::disabled_t
         >
         class generator_2d_t
           : public std::enable_shared_from_this
             < generator_2d_t
               < T_rng
               , T_size
+              , T_stats
               >
             >
         {
         public:
-          using rng_t  = T_rng;
-          using size_t = T_size;
+          using rng_t   = T_rng;
+          using size_t  = T_size;
+          using stats_t = T_stats;
           
           using shared_t = std::shared_ptr< generator_2d_t >;
           
@@ -42,9 +50,17 @@ namespace wonder_rabbit_project
           
           using coordinate_t = to_glm_vec2_t< size_t >;
           
-          using data_t = std::vector< std::vector< std::uint8_t > >;
+          using data_t = grid_2d_t< size_t >;
           using shared_data_t = std::shared_ptr< data_t >;
           
+          using renderer_t = renderer_2d_t< size_t >;
+          
+          using nested_data_t = typename data_t::nested_data_t;
+          using shared_nested_data_t = std::shared_ptr< nested_data_t >;
+          
+          using row_t = std::vector< std::uint8_t >;
+          using row_callback_t = std::function< auto ( const size_t y, const row_t& row ) -> void >;
+          
           static constexpr auto default_size = size_t( 13 );
           
         private:
@@ -57,6 +73,31 @@ namespace wonder_rabbit_project
           
           const std::vector< coordinate_t > _directions;
           
+          const std::vector< std::array< std::uint8_t, dimension * 2 > > _direction_permutations;
+          
+          static constexpr auto frame_step_bits = std::uint8_t( 3 );
+          static constexpr auto frame_step_mask = std::uint8_t( ( 1 << frame_step_bits ) - 1 );
+          
+          static_assert( dimension * 2 <= frame_step_mask, "direction steps do not fit in a drill stack frame." );
+          
+          static constexpr auto random_bits_per_draw = uniform_bits( std::uint64_t( rng_t::max() - rng_t::min() ) );
+          
+          static_assert( random_bits_per_draw > 0, "rng has no random bit." );
+          
+          std::vector< std::uint8_t > _drill_stack;
+          
+          // eller's state, O( width ); labels of the sets are in [ 0, cells of a row )
+          std::vector< std::size_t > _eller_set;
+          std::vector< std::size_t > _eller_parent;
+          std::vector< std::size_t > _eller_members;
+          std::vector< std::size_t > _eller_free;
+          std::vector< bool >        _eller_down;
+          std::vector< bool >        _eller_label_down;
+          row_t                      _eller_row;
+          
+          typename rng_t::result_type _random_bits;
+          std::size_t                 _random_bits_count;
+          
           std::string _block_cell_string
                     , _road_cell_string 
                     , _unknown_cell_string
@@ -65,10 +106,14 @@ namespace wonder_rabbit_project
                     ;
           
           coordinate_t _far_cell;
-          size_t       _far_distance;
+          std::size_t  _far_distance;
           
           generator::algorithm _algorithm;
           
+          maze::packing _packing;
+          
+          stats_t _stats;
+          
           template < class T >
           static inline auto odd( T value )
             -> bool
@@ -90,30 +135,71 @@ namespace wonder_rabbit_project
             return dist( *_rng ) * 2 + 1;
           }
           
-          auto generate_random_directions_indices( )
-            -> std::vector< std::uint_fast8_t >
+          // one draw selects one of the ( dimension * 2 )! direction orders
+          auto generate_random_direction_permutation( )
+            -> std::uint8_t
+          { return std::uint8_t( ( (*_rng)() - rng_t::min() ) % _direction_permutations.size() ); }
+          
+          // random_bits_per_draw bits per draw, e.g. 24 for std::ranlux24 and 64 for std::mt19937_64
+          auto generate_random_bit( )
+            -> bool
           {
-            std::vector< std::uint_fast8_t > r( dimension * 2 );
-            std::uniform_int_distribution< std::uint_fast8_t > dist( 0, dimension * 2 - 1 );
-            std::iota( std::begin( r ), std::end( r ), 0 );
-            std::shuffle( std::begin( r ), std::end( r ), *_rng );
+            if ( _random_bits_count == 0 )
+            {
+              _random_bits = (*_rng)() - rng_t::min();
+              _random_bits_count = random_bits_per_draw;
+            }
+            
+            --_random_bits_count;
+            const auto r = _random_bits & 1;
+            _random_bits >>= 1;
             return r;
           }
           
-          auto drill( const coordinate_t& p, std::size_t distance = 0 )
+          // depth first drill on an explicit stack.
+          // a stack frame is 1 byte: ( permutation index << frame_step_bits ) | next step.
+          // the current cell is not stored, it is restored on pop from the parent frame's last step.
+          // the drill distance of a frame is ( depth * 2 ).
+          auto drill( const coordinate_t& origin )
             -> void
           {
-            if ( distance > _far_distance )
-            {
-              _far_cell = p;
-              _far_distance = distance;
-            }
+            auto& stack = _drill_stack;
             
-            const auto indices = generate_random_directions_indices();
+            stack.clear();
+            stack.reserve( std::size_t( _width >> 1 ) * std::size_t( _height >> 1 ) + 1 );
             
-            for ( const auto i : indices )
+            const auto direction_of = [ this ]( const std::uint8_t frame, const std::uint8_t step )
+              -> const coordinate_t&
+            { return _directions[ _direction_permutations[ frame >> frame_step_bits ][ step ] ]; };
+            
+            auto p = origin;
+            
+            stack.push_back( generate_random_direction_permutation() << frame_step_bits );
+            _stats.on_push( stack.size() );
+            
+            while ( not stack.empty() )
             {
-              const auto& d = _directions[ i ];
+              auto& frame = stack.back();
+              const auto step = std::uint8_t( frame & frame_step_mask );
+              
+              if ( step == dimension * 2 )
+              {
+                stack.pop_back();
+                _stats.on_pop();
+                
+                if ( not stack.empty() )
+                {
+                  const auto& d = direction_of( stack.back(), ( stack.back() & frame_step_mask ) - 1 );
+                  p -= d;
+                  p -= d;
+                }
+                
+                continue;
+              }
+              
+              ++frame;
+              
+              const auto& d = direction_of( frame, step );
               
               const auto q1 = p + d;
               const auto q2 = q1 + d;
@@ -121,14 +207,210 @@ namespace wonder_rabbit_project
               if ( q2.x < 0 or q2.x >= _width or q2.y < 0 or q2.y >= _height )
                 continue;
               
-              if ( not road( (*_maze)[ q2.y ][ q2.x ] ) )
+              if ( not road( _maze -> get( q2 ) ) )
+              {
+                _maze -> set( q1, cell_type::road );
+                _maze -> set( q2, cell_type::road );
+                _stats.on_expand();
+                
+                p = q2;
+                
+                const auto distance = stack.size() * 2;
+                
+                if ( distance > _far_distance )
+                {
+                  _far_cell = p;
+                  _far_distance = distance;
+                }
+                
+                stack.push_back( generate_random_direction_permutation() << frame_step_bits );
+                _stats.on_push( stack.size() );
+              }
+            }
+          }
+          
+          auto generate_drill( )
+            -> void
+          {
+            _stats.reset();
+            const auto timer = _stats.timer( maze::stats::phase::generate );
+            
+            const coordinate_t goal
+              { generate_random_odd( _width  )
+              , generate_random_odd( _height )
+              };
+            
+            _maze -> set( goal, cell_type::goal );
+            
+            _far_distance = 0;
+            _far_cell = goal;
+            
+            drill( goal );
+            
+            _maze -> set( _far_cell, cell_type::start );
+          }
+          
+          auto eller_find( std::size_t label )
+            -> std::size_t
+          {
+            while ( _eller_parent[ label ] != label )
+              label = _eller_parent[ label ] = _eller_parent[ _eller_parent[ label ] ];
+            return label;
+          }
+          
+          // eller's algorithm: one row of cells at a time, the state is O( width ).
+          // start and goal are drawn at random before the first row,
+          // the maze is perfect so they are always connected.
+          auto generate_eller( const row_callback_t& f )
+            -> void
+          {
+            const auto cells_x = std::size_t( _width  >> 1 );
+            const auto cells_y = std::size_t( _height >> 1 );
+            
+            if ( cells_x == 0 or cells_y == 0 )
+              throw std::runtime_error( "maze size is too small." );
+            
+            _stats.reset();
+            const auto timer = _stats.timer( maze::stats::phase::generate );
+            
+            const coordinate_t goal
+              { generate_random_odd( _width  )
+              , generate_random_odd( _height )
+              };
+            
+            _random_bits_count = 0;
+            
+            coordinate_t start;
+            do
+              start = coordinate_t
+                { generate_random_odd( _width  )
+                , generate_random_odd( _height )
+                };
+            while ( start == goal and cells_x * cells_y > 1 );
+            
+            _eller_set       .assign( cells_x, 0 );
+            _eller_parent    .resize( cells_x );
+            _eller_members   .resize( cells_x );
+            _eller_down      .assign( cells_x, false );
+            _eller_label_down.resize( cells_x );
+            _eller_row       .assign( _width, cell_type::block );
+            
+            _eller_free.resize( cells_x );
+            std::iota( _eller_free.rbegin(), _eller_free.rend(), 0 );
+            
+            auto& row = _eller_row;
+            
+            f( 0, row );
+            
+            for ( std::size_t cy = 0; cy < cells_y; ++cy )
+            {
+              const auto last = cy + 1 == cells_y;
+              const auto y = size_t( cy * 2 + 1 );
+              
+              // cells not joined from above get a new set
+              for ( std::size_t cx = 0; cx < cells_x; ++cx )
+              {
+                if ( not _eller_down[ cx ] )
+                {
+                  _eller_set[ cx ] = _eller_free.back();
+                  _eller_free.pop_back();
+                }
+                _eller_parent[ _eller_set[ cx ] ] = _eller_set[ cx ];
+              }
+              
+              // join the neighbours at random ( all of them in the last row ) unless already in a same set
+              std::fill( row.begin(), row.end(), cell_type::block );
+              
+              for ( std::size_t cx = 0; cx < cells_x; ++cx )
               {
-                (*_maze)[ q1.y ][ q1.x ] = cell_type::road;
-                (*_maze)[ q2.y ][ q2.x ] = cell_type::road;
+                row[ cx * 2 + 1 ] = cell_type::road;
+                _stats.on_expand();
+                
+                if ( cx + 1 == cells_x )
+                  continue;
                 
-                drill( q2, distance + 2 );
+                const auto a = eller_find( _eller_set[ cx     ] );
+                const auto b = eller_find( _eller_set[ cx + 1 ] );
+                
+                if ( a != b and ( last or generate_random_bit() ) )
+                {
+                  _eller_parent[ b ] = a;
+                  row[ cx * 2 + 2 ] = cell_type::road;
+                }
               }
+              
+              if ( start.y == y )
+                row[ start.x ] = cell_type::start;
+              
+              if ( goal.y == y )
+                row[ goal.x ] = cell_type::goal;
+              
+              f( y, row );
+              
+              std::fill( row.begin(), row.end(), cell_type::block );
+              
+              if ( last )
+                break;
+              
+              // join downwards at random, at least once for each set
+              for ( std::size_t cx = 0; cx < cells_x; ++cx )
+              {
+                _eller_set[ cx ] = eller_find( _eller_set[ cx ] );
+                _eller_members   [ _eller_set[ cx ] ] = 0;
+                _eller_label_down[ _eller_set[ cx ] ] = false;
+              }
+              
+              for ( std::size_t cx = 0; cx < cells_x; ++cx )
+                ++_eller_members[ _eller_set[ cx ] ];
+              
+              for ( std::size_t cx = 0; cx < cells_x; ++cx )
+              {
+                const auto label = _eller_set[ cx ];
+                const auto last_member = --_eller_members[ label ] == 0;
+                const auto down
+                  =  generate_random_bit()
+                  or ( last_member and not _eller_label_down[ label ] )
+                  ;
+                
+                _eller_down[ cx ] = down;
+                
+                if ( down )
+                {
+                  _eller_label_down[ label ] = true;
+                  row[ cx * 2 + 1 ] = cell_type::road;
+                }
+              }
+              
+              f( y + 1, row );
+              
+              // the labels not carried downwards are free for the next row
+              _eller_free.clear();
+              for ( std::size_t label = 0; label < cells_x; ++label )
+                _eller_label_down[ label ] = false;
+              for ( std::size_t cx = 0; cx < cells_x; ++cx )
+                if ( _eller_down[ cx ] )
+                  _eller_label_down[ _eller_set[ cx ] ] = true;
+              for ( std::size_t label = cells_x; label > 0; --label )
+                if ( not _eller_label_down[ label - 1 ] )
+                  _eller_free.push_back( label - 1 );
             }
+            
+            f( _height - 1, row );
+          }
+          
+          auto make_renderer( ) const
+            -> std::shared_ptr< renderer_t >
+          {
+            auto r = std::make_shared< renderer_t >();
+            
+            r -> block_cell_string( _block_cell_string )
+              -> road_cell_string( _road_cell_string )
+              -> unknown_cell_string( _unknown_cell_string )
+              -> start_cell_string( _start_cell_string )
+              -> goal_cell_string( _goal_cell_string )
+              ;
+            
+            return r;
           }
           
         public:
@@ -136,12 +418,15 @@ namespace wonder_rabbit_project
           generator_2d_t()
             : _rng ( std::make_shared< rng_t >( ) )
             , _directions( generate_directions< coordinate_t >() )
+            , _direction_permutations( generate_direction_permutations< dimension * 2 >() )
+            , _random_bits_count( 0 )
             , _block_cell_string   ( std::to_string( cell_type::block ) )
             , _road_cell_string    ( std::to_string( cell_type::road  ) )
             , _unknown_cell_string ( u8"?" )
             , _start_cell_string   ( u8"S" )
             , _goal_cell_string    ( u8"G" )
             , _algorithm( generator::algorithm::drill )
+            , _packing( maze::packing::byte )
           { }
           
           auto algorithm( const generator::algorithm a )
@@ -151,6 +436,13 @@ namespace wonder_rabbit_project
             return this ->shared_from_this();
           }
           
+          auto packing( const maze::packing p )
+            -> shared_t
+          {
+            _packing = p;
+            return this -> shared_from_this();
+          }
+          
           auto size( const size_t size_ )
             -> shared_t
           { return this -> width( size_ ) -> height( size_ ); }
@@ -213,50 +505,114 @@ namespace wonder_rabbit_project
             return this -> shared_from_this();
           }
           
+          // the data buffer is reused if nobody else holds the last data()
           auto generate( )
             -> shared_t
           {
-            _maze = std::make_shared< data_t >( _height, std::vector< std::uint8_t >( _width, cell_type::block ) );
+            if ( _maze and _maze.use_count() == 1 and _maze -> packing() == _packing )
+              _maze -> resize( _width, _height );
+            else
+              _maze = std::make_shared< data_t >( _width, _height, _packing );
             
-            const coordinate_t goal
-              { generate_random_odd( _width  )
-              , generate_random_odd( _height )
-              };
+            switch ( _algorithm )
+            { case generator::algorithm::drill:
+                generate_drill();
+                break;
+                
+              case generator::algorithm::eller:
+                generate_eller
+                ( [ this ]( const size_t y, const row_t& row )
+                  {
+                    for ( size_t x = 0; x < _width; ++x )
+                      _maze -> set( x, y, row[ x ] );
+                  }
+                );
+                break;
+                
+              default:
+                throw std::runtime_error( "invalid algorithm." );
+            }
             
-            (*_maze)[ goal.y ][ goal.x ] = cell_type::goal;
+            return this -> shared_from_this();
+          }
+          
+          // streaming generate: each finished row is passed to f.
+          // eller keeps only O( width ) state and does not build data(),
+          // the other algorithms generate the whole maze first.
+          auto generate( const row_callback_t& f )
+            -> shared_t
+          {
+            if ( _algorithm == generator::algorithm::eller )
+            {
+              generate_eller( f );
+              return this -> shared_from_this();
+            }
             
-            _far_distance = 0;
-            _far_cell = goal;
+            generate();
             
-            drill( goal );
+            row_t row( _width );
             
-            (*_maze)[ _far_cell.y ][ _far_cell.x ] = cell_type::start;
+            for ( size_t y = 0; y < _height; ++y )
+            {
+              for ( size_t x = 0; x < _width; ++x )
+                row[ x ] = _maze -> get( x, y );
+              f( y, row );
+            }
             
             return this -> shared_from_this();
           }
           
-          auto to_string( ) const
-            -> std::string
+          // streaming generate to a stream with the cell strings
+          auto generate( std::ostream& o )
+            -> shared_t
           {
-            std::stringstream r;
-            for ( const auto maze_raw : *_maze )
+            const auto r = make_renderer();
+            
+            if ( _algorithm != generator::algorithm::eller )
             {
-              for ( const auto maze_cell : maze_raw )
-                switch ( maze_cell )
-                { case cell_type::block: r << _block_cell_string;   break;
-                  case cell_type::road : r << _road_cell_string;    break;
-                  case cell_type::start: r << _start_cell_string;   break;
-                  case cell_type::goal : r << _goal_cell_string;    break;
-                  default              : r << _unknown_cell_string;
-                }
-              r << "\n";
+              generate();
+              r -> render( *_maze, o );
+              return this -> shared_from_this();
             }
-            return r.str();
+            
+            std::string chunk;
+            chunk.reserve( renderer_t::default_chunk_size );
+            
+            generate_eller
+            ( [ &r, &o, &chunk ]( const size_t, const row_t& row )
+              {
+                r -> render_row( row.data(), size_t( row.size() ), chunk );
+                
+                if ( chunk.size() >= renderer_t::default_chunk_size )
+                {
+                  o.write( chunk.data(), std::streamsize( chunk.size() ) );
+                  chunk.clear();
+                }
+              }
+            );
+            
+            o.write( chunk.data(), std::streamsize( chunk.size() ) );
+            
+            return this -> shared_from_this();
           }
           
+          auto to_string( ) const
+            -> std::string
+          { return make_renderer() -> to_string( *_maze ); }
+          
           auto data( )
             -> shared_data_t
           { return _maze; }
+          
+          // counters and timings of the last generate(); empty with stats::disabled_t
+          auto stats( ) const
+            -> const stats_t&
+          { return _stats; }
+          
+          // adapter for the old nested vector data
+          auto nested_data( ) const
+            -> shared_nested_data_t
+          { return std::make_shared< nested_data_t >( _maze -> to_nested() ); }
         };
       }
     }
@@ -0,0 +1,623 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined( __unix__ ) or defined( __APPLE__ )
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define WONDERLAND_MAZE_HAS_MMAP
+#endif
+
+#include <boost/optional.hpp>
+
+#include <glm/glm.hpp>
+
+#include "traits.hxx"
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      // contiguous 2d cell grid.
+      //   packing::byte : one row is `stride()` bytes, rows are continuous in one buffer.
+      //   packing::bit  : one row is `stride()` 64-bit words, 1 bit per cell ( road or block ).
+      //                   start and goal cells are kept as coordinates.
+      // the cells are owned by the grid, or are a view of an external memory ( e.g. map_binary ).
+      //
+      // binary format ( native byte order, 64 bytes header then the cells ):
+      //    0 : magic "WRMAZE2D"
+      //    8 : uint32 byte order mark 0x01020304
+      //   12 : uint16 version, uint16 packing ( 0: byte, 1: bit )
+      //   16 : uint64 width, uint64 height
+      //   32 : uint64 start x, y ( no_cell if none )
+      //   48 : uint64 goal  x, y ( no_cell if none )
+      //   64 : height * stride bytes ( byte ) or 64-bit words ( bit )
+      template
+      < class T_size = std::int_fast32_t
+      >
+      class grid_2d_t
+      {
+      public:
+        using size_t = T_size;
+        
+        using coordinate_t = to_glm_vec2_t< size_t >;
+        
+        using nested_data_t = std::vector< std::vector< std::uint8_t > >;
+        
+        using word_t = std::uint64_t;
+        
+        static constexpr auto word_bits = std::size_t( 64 );
+        
+        static constexpr auto binary_version = std::uint16_t( 1 );
+        static constexpr auto no_cell        = std::numeric_limits< std::uint64_t >::max();
+      
+      private:
+        struct binary_header_t
+        {
+          char          magic[ 8 ];
+          std::uint32_t byte_order;
+          std::uint16_t version;
+          std::uint16_t packing;
+          std::uint64_t width;
+          std::uint64_t height;
+          std::uint64_t start[ 2 ];
+          std::uint64_t goal [ 2 ];
+        };
+        
+        static_assert( sizeof( binary_header_t ) == 64, "binary header must be 64 bytes." );
+        
+        static auto binary_magic( )
+          -> const char*
+        { return "WRMAZE2D"; }
+        
+
+        size_t _width;
+        size_t _height;
+        
+        maze::packing _packing;
+        
+        std::size_t _stride;
+        
+        // owned storage
+        std::vector< std::uint8_t > _bytes;
+        std::vector< word_t >       _words;
+        
+        // the cells, in the owned storage or in _external
+        std::uint8_t* _byte_data;
+        word_t*       _word_data;
+        
+        std::shared_ptr< void > _external;
+        
+        boost::optional< coordinate_t > _start;
+        boost::optional< coordinate_t > _goal;
+        
+        static inline auto stride_of( const size_t width, const maze::packing p )
+          -> std::size_t
+        {
+          return p == maze::packing::bit
+            ? ( std::size_t( width ) + word_bits - 1 ) / word_bits
+            : std::size_t( width )
+            ;
+        }
+        
+        static inline auto same( const boost::optional< coordinate_t >& a, const size_t x, const size_t y )
+          -> bool
+        { return a and a -> x == x and a -> y == y; }
+        
+        // bytes ( byte ) or words ( bit ) of the cells
+        auto storage_size( ) const
+          -> std::size_t
+        { return _stride * std::size_t( _height ); }
+        
+        // packing::byte only
+        auto track_scan( const std::uint8_t value )
+          -> void
+        {
+          const auto size = storage_size();
+          const auto p = static_cast< const std::uint8_t* >( std::memchr( _byte_data, value, size ) );
+          
+          if ( p )
+          {
+            const auto i = std::size_t( p - _byte_data );
+            track( size_t( i % _stride ), size_t( i / _stride ), value );
+          }
+        }
+        
+        inline auto track( const size_t x, const size_t y, const std::uint8_t value )
+          -> void
+        {
+          if ( value == cell_type::start )
+            _start = coordinate_t( x, y );
+          else if ( same( _start, x, y ) )
+            _start = boost::none;
+          
+          if ( value == cell_type::goal )
+            _goal = coordinate_t( x, y );
+          else if ( same( _goal, x, y ) )
+            _goal = boost::none;
+        }
+      
+        // an empty grid with the size and the packing of the header
+        static auto from_binary_header( const binary_header_t& h )
+          -> grid_2d_t
+        {
+          if ( std::memcmp( h.magic, binary_magic(), sizeof( h.magic ) ) != 0 )
+            throw std::runtime_error( "maze binary magic is wrong." );
+          
+          if ( h.byte_order != 0x01020304 )
+            throw std::runtime_error( "maze binary byte order is not supported." );
+          
+          if ( h.version != binary_version or h.packing > 1 )
+            throw std::runtime_error( "maze binary version is not supported." );
+          
+          if ( h.width == 0 or h.height == 0 )
+            throw std::runtime_error( "maze binary size is empty." );
+          
+          if ( h.width  > std::uint64_t( std::numeric_limits< size_t >::max() )
+            or h.height > std::uint64_t( std::numeric_limits< size_t >::max() )
+             )
+            throw std::runtime_error( "maze binary size is too large." );
+          
+          const auto p = h.packing == 1 ? maze::packing::bit : maze::packing::byte;
+          
+          // the cells are indexed with width * height ( e.g. the solver buffers ),
+          // and the header and the cells must be addressable in a std::size_t.
+          constexpr auto limit = std::numeric_limits< std::size_t >::max();
+          
+          const auto width  = std::size_t( h.width  );
+          const auto height = std::size_t( h.height );
+          const auto unit   = p == maze::packing::bit ? sizeof( word_t ) : std::size_t( 1 );
+          
+          if ( std::uint64_t( width ) != h.width or std::uint64_t( height ) != h.height
+            or width > limit / height
+            or stride_of( size_t( width ), p ) > ( limit - sizeof( binary_header_t ) ) / unit / height
+             )
+            throw std::runtime_error( "maze binary size is too large." );
+          
+          grid_2d_t r( 0, 0, p );
+          
+          r._width  = size_t( width  );
+          r._height = size_t( height );
+          r._stride = stride_of( r._width, r._packing );
+          
+          return r;
+        }
+        
+        // bytes of the cells in the binary format; from_binary_header checked it does not overflow
+        auto storage_bytes( ) const
+          -> std::size_t
+        {
+          return _packing == maze::packing::bit
+            ? storage_size() * sizeof( word_t )
+            : storage_size()
+            ;
+        }
+        
+        auto track_binary_header( const binary_header_t& h )
+          -> void
+        {
+          const auto in_range = [ this ]( const std::uint64_t* p )
+          { return p[ 0 ] < std::uint64_t( _width ) and p[ 1 ] < std::uint64_t( _height ); };
+          
+          if ( in_range( h.start ) )
+            _start = coordinate_t( size_t( h.start[ 0 ] ), size_t( h.start[ 1 ] ) );
+          
+          if ( in_range( h.goal ) )
+            _goal = coordinate_t( size_t( h.goal[ 0 ] ), size_t( h.goal[ 1 ] ) );
+        }
+        
+      public:
+        
+        grid_2d_t
+        ( const size_t width  = 0
+        , const size_t height = 0
+        , const maze::packing p = maze::packing::byte
+        , const std::uint8_t value = cell_type::block
+        )
+          : _width( 0 )
+          , _height( 0 )
+          , _packing( p )
+          , _stride( 0 )
+          , _byte_data( nullptr )
+          , _word_data( nullptr )
+        { resize( width, height, value ); }
+        
+        // a copy owns its cells, also from an external memory
+        grid_2d_t( const grid_2d_t& o )
+          : _width( o._width )
+          , _height( o._height )
+          , _packing( o._packing )
+          , _stride( o._stride )
+          , _byte_data( nullptr )
+          , _word_data( nullptr )
+          , _start( o._start )
+          , _goal( o._goal )
+        {
+          if ( _packing == maze::packing::bit )
+            _words.assign( o._word_data, o._word_data + o.storage_size() );
+          else
+            _bytes.assign( o._byte_data, o._byte_data + o.storage_size() );
+          
+          _byte_data = _bytes.data();
+          _word_data = _words.data();
+        }
+        
+        grid_2d_t( grid_2d_t&& o )
+          : _width( o._width )
+          , _height( o._height )
+          , _packing( o._packing )
+          , _stride( o._stride )
+          , _bytes( std::move( o._bytes ) )
+          , _words( std::move( o._words ) )
+          , _byte_data( o._external ? o._byte_data : _bytes.data() )
+          , _word_data( o._external ? o._word_data : _words.data() )
+          , _external( std::move( o._external ) )
+          , _start( o._start )
+          , _goal( o._goal )
+        {
+          o._byte_data = nullptr;
+          o._word_data = nullptr;
+          o._width = o._height = 0;
+        }
+        
+        auto operator=( grid_2d_t o )
+          -> grid_2d_t&
+        {
+          _width    = o._width;
+          _height   = o._height;
+          _packing  = o._packing;
+          _stride   = o._stride;
+          _bytes    = std::move( o._bytes );
+          _words    = std::move( o._words );
+          _byte_data = o._external ? o._byte_data : _bytes.data();
+          _word_data = o._external ? o._word_data : _words.data();
+          _external = std::move( o._external );
+          _start    = o._start;
+          _goal     = o._goal;
+          return *this;
+        }
+        
+        // adopts a byte buffer of width * height cells, and tracks its start / goal cells.
+        static auto adopt( const size_t width, const size_t height, std::vector< std::uint8_t >&& bytes )
+          -> grid_2d_t
+        {
+          if ( bytes.size() != std::size_t( width ) * std::size_t( height ) )
+            throw std::runtime_error( "maze data size is not width * height." );
+          
+          grid_2d_t r;
+          
+          r._width     = width;
+          r._height    = height;
+          r._stride    = std::size_t( width );
+          r._bytes     = std::move( bytes );
+          r._byte_data = r._bytes.data();
+          
+          r.track_scan( cell_type::start );
+          r.track_scan( cell_type::goal  );
+          
+          return r;
+        }
+        
+        auto resize( const size_t width, const size_t height, const std::uint8_t value = cell_type::block )
+          -> void
+        {
+          if ( width < 0 or height < 0 )
+            throw std::runtime_error( "grid size is negative." );
+          
+          _width  = width;
+          _height = height;
+          _stride = stride_of( width, _packing );
+          
+          const auto size = _stride * std::size_t( height );
+          
+          _external.reset();
+          
+          if ( _packing == maze::packing::bit )
+          {
+            _bytes.clear();
+            _words.resize( size );
+          }
+          else
+          {
+            _words.clear();
+            _bytes.resize( size );
+          }
+          
+          _byte_data = _bytes.data();
+          _word_data = _words.data();
+          
+          fill( value );
+        }
+        
+        auto fill( const std::uint8_t value )
+          -> void
+        {
+          if ( _packing == maze::packing::bit )
+            std::fill( _word_data, _word_data + storage_size(), ( value & cell_type::road ) ? ~word_t( 0 ) : word_t( 0 ) );
+          else
+            std::fill( _byte_data, _byte_data + storage_size(), value );
+          
+          _start = boost::none;
+          _goal  = boost::none;
+        }
+        
+        auto width( ) const
+          -> size_t
+        { return _width; }
+        
+        auto height( ) const
+          -> size_t
+        { return _height; }
+        
+        // bytes per row for packing::byte, words per row for packing::bit
+        auto stride( ) const
+          -> std::size_t
+        { return _stride; }
+        
+        auto packing( ) const
+          -> maze::packing
+        { return _packing; }
+        
+        auto empty( ) const
+          -> bool
+        { return _width == 0 or _height == 0; }
+        
+        auto get( const size_t x, const size_t y ) const
+          -> std::uint8_t
+        {
+          if ( _packing == maze::packing::byte )
+            return _byte_data[ std::size_t( y ) * _stride + std::size_t( x ) ];
+          
+          const auto word = _word_data[ std::size_t( y ) * _stride + std::size_t( x ) / word_bits ];
+          
+          if ( not ( ( word >> ( std::size_t( x ) % word_bits ) ) & 1 ) )
+            return cell_type::block;
+          
+          if ( same( _start, x, y ) )
+            return cell_type::start;
+          
+          if ( same( _goal, x, y ) )
+            return cell_type::goal;
+          
+          return cell_type::road;
+        }
+        
+        auto get( const coordinate_t& p ) const
+          -> std::uint8_t
+        { return get( p.x, p.y ); }
+        
+        auto set( const size_t x, const size_t y, const std::uint8_t value )
+          -> void
+        {
+          track( x, y, value );
+          
+          if ( _packing == maze::packing::byte )
+          {
+            _byte_data[ std::size_t( y ) * _stride + std::size_t( x ) ] = value;
+            return;
+          }
+          
+          auto& word = _word_data[ std::size_t( y ) * _stride + std::size_t( x ) / word_bits ];
+          const auto mask = word_t( 1 ) << ( std::size_t( x ) % word_bits );
+          
+          if ( value & cell_type::road )
+            word |= mask;
+          else
+            word &= ~mask;
+        }
+        
+        auto set( const coordinate_t& p, const std::uint8_t value )
+          -> void
+        { set( p.x, p.y, value ); }
+        
+        // raw row access for packing::byte.
+        // note: start / goal written through it are not tracked by start_cell() / goal_cell().
+        auto row_data( const size_t y )
+          -> std::uint8_t*
+        {
+          if ( _packing != maze::packing::byte )
+            throw std::logic_error( "row_data requires packing::byte." );
+          return _byte_data + std::size_t( y ) * _stride;
+        }
+        
+        auto row_data( const size_t y ) const
+          -> const std::uint8_t*
+        {
+          if ( _packing != maze::packing::byte )
+            throw std::logic_error( "row_data requires packing::byte." );
+          return _byte_data + std::size_t( y ) * _stride;
+        }
+        
+        // raw row access for packing::bit; bit ( x % 64 ) of word ( x / 64 ) is road.
+        auto row_words( const size_t y ) const
+          -> const word_t*
+        {
+          if ( _packing != maze::packing::bit )
+            throw std::logic_error( "row_words requires packing::bit." );
+          return _word_data + std::size_t( y ) * _stride;
+        }
+        
+        // the last start / goal cell written by set(), if any.
+        auto start_cell( ) const
+          -> const boost::optional< coordinate_t >&
+        { return _start; }
+        
+        auto goal_cell( ) const
+          -> const boost::optional< coordinate_t >&
+        { return _goal; }
+        
+        auto write_binary( std::ostream& o ) const
+          -> void
+        {
+          binary_header_t h;
+          
+          std::memcpy( h.magic, binary_magic(), sizeof( h.magic ) );
+          h.byte_order = 0x01020304;
+          h.version    = binary_version;
+          h.packing    = _packing == maze::packing::bit ? 1 : 0;
+          h.width      = std::uint64_t( _width  );
+          h.height     = std::uint64_t( _height );
+          h.start[ 0 ] = _start ? std::uint64_t( _start -> x ) : std::uint64_t( no_cell );
+          h.start[ 1 ] = _start ? std::uint64_t( _start -> y ) : std::uint64_t( no_cell );
+          h.goal [ 0 ] = _goal  ? std::uint64_t( _goal  -> x ) : std::uint64_t( no_cell );
+          h.goal [ 1 ] = _goal  ? std::uint64_t( _goal  -> y ) : std::uint64_t( no_cell );
+          
+          o.write( reinterpret_cast< const char* >( &h ), sizeof( h ) );
+          
+          if ( _packing == maze::packing::bit )
+            o.write( reinterpret_cast< const char* >( _word_data ), storage_size() * sizeof( word_t ) );
+          else
+            o.write( reinterpret_cast< const char* >( _byte_data ), storage_size() );
+          
+          if ( not o )
+            throw std::runtime_error( "maze binary write failed." );
+        }
+        
+        static auto read_binary( std::istream& i )
+          -> grid_2d_t
+        {
+          binary_header_t h;
+          
+          if ( not i.read( reinterpret_cast< char* >( &h ), sizeof( h ) ) )
+            throw std::runtime_error( "maze binary header is broken." );
+          
+          auto r = from_binary_header( h );
+          
+          const auto bytes = r.storage_bytes();
+          
+          // a seekable stream is checked to have all the cells before the allocation
+          const auto here = i.tellg();
+          
+          if ( here != std::streampos( -1 ) and i.seekg( 0, std::ios::end ) )
+          {
+            const auto rest = i.tellg() - here;
+            i.seekg( here );
+            
+            if ( rest < 0 or std::uint64_t( rest ) < std::uint64_t( bytes ) )
+              throw std::runtime_error( "maze binary cells are broken." );
+          }
+          else
+            i.clear();
+          
+          r.resize( r._width, r._height );
+          
+          if ( not i.read( r._packing == maze::packing::bit ? reinterpret_cast< char* >( r._word_data ) : reinterpret_cast< char* >( r._byte_data ), bytes ) )
+            throw std::runtime_error( "maze binary cells are broken." );
+          
+          r.track_binary_header( h );
+          
+          return r;
+        }
+        
+        // the cells are a view of the file mapping ( copy on write ), not copied.
+        // without mmap it falls back to read_binary.
+        static auto map_binary( const std::string& path )
+          -> std::shared_ptr< grid_2d_t >
+        {
+#ifdef WONDERLAND_MAZE_HAS_MMAP
+          const auto fd = ::open( path.c_str(), O_RDONLY );
+          
+          if ( fd < 0 )
+            throw std::runtime_error( "maze binary file can not open." );
+          
+          struct stat st;
+          
+          if ( ::fstat( fd, &st ) != 0 or std::size_t( st.st_size ) < sizeof( binary_header_t ) )
+          {
+            ::close( fd );
+            throw std::runtime_error( "maze binary header is broken." );
+          }
+          
+          const auto length = std::size_t( st.st_size );
+          const auto p = ::mmap( nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+          
+          ::close( fd );
+          
+          if ( p == MAP_FAILED )
+            throw std::runtime_error( "maze binary file can not map." );
+          
+          const std::shared_ptr< void > mapping( p, [ length ]( void* q ){ ::munmap( q, length ); } );
+          
+          const auto& h = *static_cast< const binary_header_t* >( p );
+          
+          auto r = std::make_shared< grid_2d_t >( from_binary_header( h ) );
+          
+          const auto bytes = r -> storage_bytes();
+          
+          if ( length - sizeof( binary_header_t ) < bytes )
+            throw std::runtime_error( "maze binary cells are broken." );
+          
+          const auto cells = static_cast< char* >( p ) + sizeof( binary_header_t );
+          
+          r -> _byte_data = r -> _packing == maze::packing::byte ? reinterpret_cast< std::uint8_t* >( cells ) : nullptr;
+          r -> _word_data = r -> _packing == maze::packing::bit  ? reinterpret_cast< word_t*       >( cells ) : nullptr;
+          r -> _external  = mapping;
+          
+          r -> track_binary_header( h );
+          
+          return r;
+#else
+          std::ifstream f( path, std::ios::binary );
+          
+          if ( not f )
+            throw std::runtime_error( "maze binary file can not open." );
+          
+          return std::make_shared< grid_2d_t >( read_binary( f ) );
+#endif
+        }
+        
+        // adapter from the old nested vector data
+        static auto from_nested( const nested_data_t& d, const maze::packing p = maze::packing::byte )
+          -> grid_2d_t
+        {
+          if ( d.empty() )
+            throw std::runtime_error( "maze data rows is empty." );
+          
+          if ( d.cbegin() -> empty() )
+            throw std::runtime_error( "maze data cols is empty." );
+          
+          const auto width = d.cbegin() -> size();
+          
+          for ( const auto& row : d )
+            if ( row.size() != width )
+              throw std::runtime_error( "maze data cols is not constant size." );
+          
+          grid_2d_t r( size_t( width ), size_t( d.size() ), p );
+          
+          for ( size_t y = 0; y < r._height; ++y )
+            for ( size_t x = 0; x < r._width; ++x )
+              r.set( x, y, d[ y ][ x ] );
+          
+          return r;
+        }
+        
+        // adapter to the old nested vector data
+        auto to_nested( ) const
+          -> nested_data_t
+        {
+          nested_data_t r( _height, std::vector< std::uint8_t >( _width ) );
+          
+          for ( size_t y = 0; y < _height; ++y )
+            for ( size_t x = 0; x < _width; ++x )
+              r[ y ][ x ] = get( x, y );
+          
+          return r;
+        }
+      };
+    }
+  }
+}
@@ -0,0 +1,453 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined( __unix__ ) or defined( __APPLE__ )
+  #include <unistd.h>
+  #define WONDERLAND_MAZE_HAS_POSIX_WRITE
+#endif
+
+#include <glm/glm.hpp>
+
+#include "traits.hxx"
+#include "grid_2d.hxx"
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      // renders a maze as text, optionally with a solver answer drawn over it.
+      // each cell value is mapped through a 256 entry table:
+      // if all the cell strings are 1 byte, a row is a straight table lookup per cell,
+      // otherwise each cell is a memcpy of its string; of a constant size if they have a same length.
+      // the answer is drawn from a bitmap of its cells while the rows are rendered.
+      // the output goes to a preallocated buffer, or in chunks to an ostream or a file descriptor.
+      template
+      < class T_size = std::int_fast32_t
+      >
+      class renderer_2d_t
+        : public std::enable_shared_from_this< renderer_2d_t< T_size > >
+      {
+      public:
+        using size_t = T_size;
+        
+        using shared_t = std::shared_ptr< renderer_2d_t< T_size > >;
+        
+        using coordinate_t = to_glm_vec2_t< size_t >;
+        
+        using data_t   = grid_2d_t< size_t >;
+        using answer_t = std::deque< coordinate_t >;
+        
+        static constexpr auto default_chunk_size = std::size_t( 1 ) << 20;
+      
+      private:
+        // not a cell_type value; marks road cells on the answer path
+        static constexpr auto path_code = std::uint8_t( 0x80 );
+        
+        // the strings up to slot_size bytes are copied as whole slots, and the output is advanced by their length.
+        // the last slot of a row may be written over its end, it needs slot_size bytes of slack.
+        static constexpr auto slot_size = std::size_t( 16 );
+        
+        std::string _block_cell_string
+                  , _road_cell_string
+                  , _unknown_cell_string
+                  , _start_cell_string
+                  , _goal_cell_string
+                  , _path_cell_string
+                  ;
+        
+        std::size_t _chunk_size;
+        
+        // rebuilt by the next render after a cell string is changed
+        std::array< char, 256 >                 _byte_table;
+        std::array< const std::string*, 256 >   _string_table;
+        std::vector< char >                     _slots;
+        std::array< std::uint8_t, 256 >         _lengths;
+        std::size_t                             _max_length;
+        // the length of all the strings, or 0 if they are not the same
+        std::size_t                             _fixed_length;
+        bool                                    _dirty;
+        
+        // the answer path as a bitmap of linear indices
+        std::vector< std::uint64_t > _path;
+        bool                         _has_path;
+        
+        std::vector< std::uint8_t > _row;
+        std::vector< char >         _chunk;
+        
+        auto build_tables( )
+          -> void
+        {
+          if ( not _dirty )
+            return;
+          
+          _dirty = false;
+          
+          _string_table.fill( &_unknown_cell_string );
+          _string_table[ cell_type::block ] = &_block_cell_string;
+          _string_table[ cell_type::road  ] = &_road_cell_string;
+          _string_table[ cell_type::start ] = &_start_cell_string;
+          _string_table[ cell_type::goal  ] = &_goal_cell_string;
+          _string_table[ path_code        ] = &_path_cell_string;
+          
+          _max_length   = 0;
+          _fixed_length = _string_table[ 0 ] -> size();
+          
+          _slots.assign( _string_table.size() * slot_size, '\0' );
+          
+          for ( std::size_t n = 0; n < _string_table.size(); ++n )
+          {
+            const auto& s = *_string_table[ n ];
+            
+            _max_length = std::max( _max_length, s.size() );
+            
+            if ( s.size() != _fixed_length )
+              _fixed_length = 0;
+            
+            _byte_table[ n ] = s.empty() ? '\0' : s[ 0 ];
+            
+            _lengths[ n ] = std::uint8_t( std::min( s.size(), std::size_t( slot_size ) ) );
+            std::memcpy( &_slots[ n * slot_size ], s.data(), _lengths[ n ] );
+          }
+        }
+        
+        // an upper bound of a rendered row with the slack
+        auto row_size_max( const std::size_t width ) const
+          -> std::size_t
+        { return width * _max_length + 1 + slot_size; }
+        
+        auto build_path( const data_t& d, const answer_t* path )
+          -> void
+        {
+          _has_path = path and not path -> empty();
+          
+          if ( not _has_path )
+            return;
+          
+          const auto cells = std::size_t( d.width() ) * std::size_t( d.height() );
+          
+          _path.assign( ( cells + 63 ) / 64, 0 );
+          
+          for ( const auto& p : *path )
+            if ( p.x >= 0 and p.y >= 0 and p.x < d.width() and p.y < d.height() )
+            {
+              const auto i = std::size_t( p.y ) * std::size_t( d.width() ) + std::size_t( p.x );
+              _path[ i >> 6 ] |= std::uint64_t( 1 ) << ( i & 63 );
+            }
+        }
+        
+        // true if any word of the path bitmap over [ begin, end ) is not 0
+        auto path_in( const std::size_t begin, const std::size_t end ) const
+          -> bool
+        {
+          if ( not _has_path )
+            return false;
+          
+          for ( auto w = begin >> 6; w <= ( end - 1 ) >> 6; ++w )
+            if ( _path[ w ] )
+              return true;
+          
+          return false;
+        }
+        
+        // the cell values of the row y, with the path code over the road cells of the answer
+        auto row_cells( const data_t& d, const size_t y )
+          -> const std::uint8_t*
+        {
+          const auto width = std::size_t( d.width() );
+          const auto begin = std::size_t( y ) * width;
+          const auto end   = begin + width;
+          
+          const bool on_path = path_in( begin, end );
+          
+          if ( d.packing() == maze::packing::byte )
+          {
+            if ( not on_path )
+              return d.row_data( y );
+            
+            const auto row = d.row_data( y );
+            _row.assign( row, row + width );
+          }
+          else
+          {
+            _row.resize( width );
+            
+            const auto words = d.row_words( y );
+            
+            for ( std::size_t x = 0; x < width; ++x )
+              _row[ x ] = std::uint8_t( ( words[ x >> 6 ] >> ( x & 63 ) ) & 1 );
+            
+            if ( d.start_cell() and d.start_cell() -> y == y )
+              _row[ std::size_t( d.start_cell() -> x ) ] = cell_type::start;
+            
+            if ( d.goal_cell() and d.goal_cell() -> y == y )
+              _row[ std::size_t( d.goal_cell() -> x ) ] = cell_type::goal;
+          }
+          
+          if ( not on_path )
+            return _row.data();
+          
+          for ( auto i = begin; i < end; )
+          {
+            if ( ( _path[ i >> 6 ] >> ( i & 63 ) ) == 0 )
+            {
+              i = ( i | 63 ) + 1;
+              continue;
+            }
+            
+            auto& cell = _row[ i - begin ];
+            
+            // start and goal stay visible at the ends of the path
+            if ( ( ( _path[ i >> 6 ] >> ( i & 63 ) ) & 1 ) and cell == cell_type::road )
+              cell = path_code;
+            
+            ++i;
+          }
+          
+          return _row.data();
+        }
+        
+        auto render_row( const std::uint8_t* cells, const std::size_t width, char* out ) const
+          -> std::size_t
+        {
+          if ( _fixed_length == 1 )
+          {
+            for ( std::size_t x = 0; x < width; ++x )
+              out[ x ] = _byte_table[ cells[ x ] ];
+            out[ width ] = '\n';
+            return width + 1;
+          }
+          
+          auto p = out;
+          
+          if ( _max_length <= slot_size )
+            for ( std::size_t x = 0; x < width; ++x )
+            {
+              std::memcpy( p, &_slots[ std::size_t( cells[ x ] ) * slot_size ], slot_size );
+              p += _lengths[ cells[ x ] ];
+            }
+          else
+            for ( std::size_t x = 0; x < width; ++x )
+            {
+              const auto& s = *_string_table[ cells[ x ] ];
+              std::memcpy( p, s.data(), s.size() );
+              p += s.size();
+            }
+          
+          *p++ = '\n';
+          
+          return std::size_t( p - out );
+        }
+        
+        // renders the rows in chunks of about chunk_size bytes and passes them to flush
+        template < class T_flush >
+        auto render_chunks( const data_t& d, const answer_t* path, const T_flush& flush )
+          -> void
+        {
+          build_tables();
+          build_path( d, path );
+          
+          const auto width   = std::size_t( d.width() );
+          const auto row_max = row_size_max( width );
+          
+          _chunk.resize( std::max( _chunk_size, row_max ) );
+          
+          std::size_t used = 0;
+          
+          for ( size_t y = 0; y < d.height(); ++y )
+          {
+            if ( used + row_max > _chunk.size() )
+            {
+              flush( _chunk.data(), used );
+              used = 0;
+            }
+            
+            used += render_row( row_cells( d, y ), width, _chunk.data() + used );
+          }
+          
+          if ( used > 0 )
+            flush( _chunk.data(), used );
+        }
+      
+      public:
+        
+        renderer_2d_t()
+          : _block_cell_string   ( std::to_string( cell_type::block ) )
+          , _road_cell_string    ( std::to_string( cell_type::road  ) )
+          , _unknown_cell_string ( u8"?" )
+          , _start_cell_string   ( u8"S" )
+          , _goal_cell_string    ( u8"G" )
+          , _path_cell_string    ( u8"*" )
+          , _chunk_size( default_chunk_size )
+          , _max_length( 1 )
+          , _fixed_length( 1 )
+          , _dirty( true )
+          , _has_path( false )
+        { }
+        
+        // the tables point to the own cell strings
+        renderer_2d_t( const renderer_2d_t& ) = delete;
+        auto operator=( const renderer_2d_t& ) -> renderer_2d_t& = delete;
+        
+        auto block_cell_string( const std::string s )
+          -> shared_t
+        {
+          _block_cell_string = s;
+          _dirty = true;
+          return this -> shared_from_this();
+        }
+        
+        auto road_cell_string( const std::string s )
+          -> shared_t
+        {
+          _road_cell_string = s;
+          _dirty = true;
+          return this -> shared_from_this();
+        }
+        
+        auto unknown_cell_string( const std::string s )
+          -> shared_t
+        {
+          _unknown_cell_string = s;
+          _dirty = true;
+          return this -> shared_from_this();
+        }
+        
+        auto start_cell_string( const std::string s )
+          -> shared_t
+        {
+          _start_cell_string = s;
+          _dirty = true;
+          return this -> shared_from_this();
+        }
+        
+        auto goal_cell_string( const std::string s )
+          -> shared_t
+        {
+          _goal_cell_string = s;
+          _dirty = true;
+          return this -> shared_from_this();
+        }
+        
+        // drawn over the road cells of the answer
+        auto path_cell_string( const std::string s )
+          -> shared_t
+        {
+          _path_cell_string = s;
+          _dirty = true;
+          return this -> shared_from_this();
+        }
+        
+        // bytes per write to an ostream or a file descriptor; a row is never split
+        auto chunk_size( const std::size_t n )
+          -> shared_t
+        {
+          _chunk_size = std::max( n, std::size_t( 1 ) );
+          return this -> shared_from_this();
+        }
+        
+        // an upper bound of the rendered size with a few bytes of slack for the output of render()
+        auto required_size( const data_t& d )
+          -> std::size_t
+        {
+          build_tables();
+          return std::size_t( d.height() ) * ( std::size_t( d.width() ) * _max_length + 1 ) + slot_size;
+        }
+        
+        // renders to a buffer of at least required_size( d ) bytes, returns the written size
+        auto render( const data_t& d, char* out, const answer_t* path = nullptr )
+          -> std::size_t
+        {
+          build_tables();
+          build_path( d, path );
+          
+          const auto width = std::size_t( d.width() );
+          
+          auto p = out;
+          
+          for ( size_t y = 0; y < d.height(); ++y )
+            p += render_row( row_cells( d, y ), width, p );
+          
+          return std::size_t( p - out );
+        }
+        
+        // renders to out, its capacity is reused
+        auto render( const data_t& d, std::string& out, const answer_t* path = nullptr )
+          -> void
+        {
+          out.resize( required_size( d ) );
+          out.resize( render( d, &out[ 0 ], path ) );
+        }
+        
+        auto render( const data_t& d, std::ostream& o, const answer_t* path = nullptr )
+          -> void
+        {
+          render_chunks
+          ( d, path
+          , [ &o ]( const char* data, const std::size_t size )
+            { o.write( data, std::streamsize( size ) ); }
+          );
+        }
+
+#ifdef WONDERLAND_MAZE_HAS_POSIX_WRITE
+        auto render( const data_t& d, const int fd, const answer_t* path = nullptr )
+          -> void
+        {
+          render_chunks
+          ( d, path
+          , [ fd ]( const char* data, std::size_t size )
+            {
+              while ( size > 0 )
+              {
+                const auto n = ::write( fd, data, size );
+                
+                if ( n < 0 )
+                {
+                  if ( errno == EINTR )
+                    continue;
+                  throw std::runtime_error( "cannot write to file descriptor." );
+                }
+                
+                data += n;
+                size -= std::size_t( n );
+              }
+            }
+          );
+        }
+#endif
+        
+        auto to_string( const data_t& d, const answer_t* path = nullptr )
+          -> std::string
+        {
+          std::string r;
+          render( d, r, path );
+          return r;
+        }
+        
+        // one row of cell values without the answer path; for the streaming generators
+        auto render_row( const std::uint8_t* cells, const size_t width, std::string& out )
+          -> void
+        {
+          build_tables();
+          
+          const auto used = out.size();
+          
+          out.resize( used + row_size_max( std::size_t( width ) ) );
+          out.resize( used + render_row( cells, std::size_t( width ), &out[ used ] ) );
+        }
+      };
+    }
+  }
+}
@@ -7,15 +7,20 @@
 #include <sstream>
 #include <algorithm>
 #include <vector>
-#include <queue>
 #include <deque>
 #include <cmath>
-
-#include <boost/optional.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <array>
+#include <istream>
 
 #include <glm/glm.hpp>
 
 #include "traits.hxx"
+#include "grid_2d.hxx"
+#include "bucket_queue.hxx"
+#include "stats.hxx"
 
 namespace wonder_rabbit_project
 {
@@ -26,21 +31,26 @@ namespace wonder_rabbit_project
       namespace solver
       {
         template
-        < class T_size = std::int_fast32_t
+        < class T_size  = std::int_fast32_t
+        , class T_stats = maze::stats::disabled_t
         >
         class solver_2d_t
-          : public std::enable_shared_from_this< solver_2d_t< T_size > >
+          : public std::enable_shared_from_this< solver_2d_t< T_size, T_stats > >
         {
         public:
-          using size_t = T_size;
+          using size_t  = T_size;
+          using stats_t = T_stats;
           
-          using shared_t = std::shared_ptr< solver_2d_t< T_size > >;
+          using shared_t = std::shared_ptr< solver_2d_t< T_size, T_stats > >;
           
           using coordinate_t = to_glm_vec2_t< size_t >;
           
-          using data_t = std::vector< std::vector< std::uint8_t > >;
+          using data_t = grid_2d_t< size_t >;
           using shared_data_t = std::shared_ptr< data_t >;
           
+          using nested_data_t = typename data_t::nested_data_t;
+          using shared_nested_data_t = std::shared_ptr< nested_data_t >;
+          
           using answer_t = std::deque< coordinate_t >;
           using shared_answer_t = std::shared_ptr< answer_t >;
           
@@ -58,16 +68,50 @@ namespace wonder_rabbit_project
           
           solver::algorithm _algorithm;
           
+          std::string _block_cell_string
+                    , _road_cell_string
+                    , _start_cell_string
+                    , _goal_cell_string
+                    ;
+          
+          static constexpr auto infinity    = std::numeric_limits< size_t >::max();
+          static constexpr auto no_previous = std::uint8_t( 0xFF );
+          
+          // search buffers, flat over the cells and reused by each solve()
+          std::vector< size_t >       _distance;
+          std::vector< std::uint8_t > _previous;
+          std::vector< std::size_t >  _queue;
+          bucket_queue_t< std::size_t > _buckets;
+          
+          stats_t _stats;
+          
           auto solve_find_cell( coordinate_t* pstart = nullptr, coordinate_t* pgoal = nullptr ) const
             -> void
           {
             bool start_finded = false;
             bool goal_finded  = false;
             
-            for ( size_t y = 0; y < _maze -> size(); ++y )
-              for ( size_t x = 0; x < (*_maze)[y].size(); ++x )
+            // fast path: the grid tracks start / goal written by set()
+            const auto& tracked_start = _maze -> start_cell();
+            const auto& tracked_goal  = _maze -> goal_cell();
+            
+            if ( ( not pstart or ( tracked_start and start( _maze -> get( *tracked_start ) ) ) )
+             and ( not pgoal  or ( tracked_goal  and goal ( _maze -> get( *tracked_goal  ) ) ) )
+               )
+            {
+              if ( pstart )
+                *pstart = *tracked_start;
+              if ( pgoal )
+                *pgoal = *tracked_goal;
+              return;
+            }
+            
+            for ( size_t y = 0; y < _height; ++y )
+              for ( size_t x = 0; x < _width; ++x )
               {
-                if ( start( (*_maze)[y][x] ) and pstart )
+                const auto cell = _maze -> get( x, y );
+                
+                if ( start( cell ) and pstart )
                 {
                   *pstart = { x, y };
                   
@@ -76,7 +120,7 @@ namespace wonder_rabbit_project
                   
                   start_finded = true;
                 }
-                else if ( goal( (*_maze)[y][x] ) and pgoal )
+                else if ( goal( cell ) and pgoal )
                 {
                   *pgoal = { x, y };
                   
@@ -94,12 +138,346 @@ namespace wonder_rabbit_project
               throw std::runtime_error( "maze data has not goal cell." );
           }
           
+          auto index( const coordinate_t& p ) const
+            -> std::size_t
+          { return std::size_t( p.y ) * std::size_t( _width ) + std::size_t( p.x ); }
+          
+          // unit cost grid: dijkstra is a plain breadth first search on a flat FIFO.
+          // the target is the index of the goal, or cells for any goal cell in the maze data.
+          // the goal is found at the discovery, returns its index or cells if not found.
+          auto search_bfs( const coordinate_t& start, const std::size_t target )
+            -> std::size_t
+          {
+            const auto cells = _distance.size();
+            auto found = cells;
+            
+            _distance[ index( start ) ] = 0;
+            _previous[ index( start ) ] = no_previous;
+            
+            if ( target == index( start ) )
+            {
+              found = target;
+              if ( not _full_gamut )
+                return found;
+            }
+            
+            _queue.clear();
+            _queue.reserve( cells );
+            
+            _queue.push_back( index( start ) );
+            _stats.on_push( 1 );
+            
+            for ( std::size_t head = 0; head < _queue.size(); ++head )
+            {
+              const auto i = _queue[ head ];
+              _stats.on_pop();
+              _stats.on_expand();
+              const auto p = coordinate_t( size_t( i % _width ), size_t( i / _width ) );
+              const auto d = _distance[ i ] + 1;
+              
+              for ( std::uint8_t k = 0; k < _directions.size(); ++k )
+              {
+                const auto np = p + _directions[ k ];
+                
+                if ( np.x < 0
+                  or np.y < 0
+                  or np.x >= _width
+                  or np.y >= _height
+                )
+                  continue;
+                
+                const auto cell = _maze -> get( np );
+                const auto j = index( np );
+                
+                if ( not road( cell ) or _distance[ j ] != infinity )
+                  continue;
+                
+                _distance[ j ] = d;
+                _previous[ j ] = k;
+                
+                if ( ( target == cells ? maze::goal( cell ) : j == target ) and found == cells )
+                {
+                  found = j;
+                  if ( not _full_gamut )
+                    return found;
+                }
+                
+                _queue.push_back( j );
+                _stats.on_push( _queue.size() - head - 1 );
+              }
+            }
+            
+            return found;
+          }
+          
+          // A* ordered by f = g + h with the manhattan distance heuristic.
+          // h is consistent on the unit cost grid, so a pushed f is the popped f or f + 2
+          // and the monotone bucket queue is enough. the goal is final when it is popped.
+          auto search_a_star( const coordinate_t& start, const coordinate_t& goal )
+            -> std::size_t
+          {
+            const auto cells = _distance.size();
+            auto found = cells;
+            
+            const auto heuristic = [ &goal ]( const coordinate_t& p )
+              -> std::size_t
+            { return std::size_t( std::abs( p.x - goal.x ) + std::abs( p.y - goal.y ) ); };
+            
+            _buckets.reset( 2, heuristic( start ) );
+            
+            _distance[ index( start ) ] = 0;
+            _previous[ index( start ) ] = no_previous;
+            _buckets.push( heuristic( start ), index( start ) );
+            _stats.on_push( 1 );
+            
+            std::size_t f, i;
+            
+            while ( _buckets.pop( f, i ) )
+            {
+              _stats.on_pop();
+              
+              const auto p = coordinate_t( size_t( i % _width ), size_t( i / _width ) );
+              
+              // stale entry, the cell was pushed again with a smaller g
+              if ( f != std::size_t( _distance[ i ] ) + heuristic( p ) )
+                continue;
+              
+              _stats.on_expand();
+              
+              if ( p == goal and found == cells )
+              {
+                found = i;
+                if ( not _full_gamut )
+                  return found;
+              }
+              
+              const auto d = _distance[ i ] + 1;
+              
+              for ( std::uint8_t k = 0; k < _directions.size(); ++k )
+              {
+                const auto np = p + _directions[ k ];
+                
+                if ( np.x < 0
+                  or np.y < 0
+                  or np.x >= _width
+                  or np.y >= _height
+                  or not road( _maze -> get( np ) )
+                )
+                  continue;
+                
+                const auto j = index( np );
+                
+                if ( _distance[ j ] <= d )
+                  continue;
+                
+                _distance[ j ] = d;
+                _previous[ j ] = k;
+                
+                _buckets.push( std::size_t( d ) + heuristic( np ), j );
+                _stats.on_push( _buckets.size() );
+              }
+            }
+            
+            return found;
+          }
+          
+          // goal is null for the first goal cell in the maze data ( dijkstra only )
+          auto search( const coordinate_t& start, const coordinate_t* goal )
+            -> shared_t
+          {
+            const auto cells = std::size_t( _width ) * std::size_t( _height );
+            
+            _distance.resize( cells );
+            _previous.resize( cells );
+            
+            std::fill( _distance.begin(), _distance.end(), size_t( infinity ) );
+            
+            std::size_t found = cells;
+            
+            {
+              const auto timer = _stats.timer( maze::stats::phase::search );
+              
+              switch( _algorithm )
+              { case solver::algorithm::dijkstra:
+                  found = search_bfs( start, goal ? index( *goal ) : cells );
+                  break;
+                  
+                case solver::algorithm::a_star:
+                  found = search_a_star( start, *goal );
+                  break;
+                  
+                default:
+                  throw std::runtime_error("invalid algorithm");
+              };
+            }
+            
+            if ( found == cells )
+              throw std::runtime_error( "maze data has not path to goal." );
+            
+            const auto timer = _stats.timer( maze::stats::phase::answer );
+            
+            if ( not _answer or _answer.use_count() > 1 )
+              _answer = std::make_shared< answer_t >();
+            
+            // the length is known from the distance: resize keeps the nodes of the last answer
+            // up to the new length, and the path is filled back to front from the goal
+            const auto length = std::size_t( _distance[ found ] ) + 1;
+            
+            _answer -> resize( length );
+            
+            auto cell = coordinate_t( size_t( found % _width ), size_t( found / _width ) );
+            
+            for ( auto n = length; n > 1; --n )
+            {
+              ( *_answer )[ n - 1 ] = cell;
+              cell -= _directions[ _previous[ index( cell ) ] ];
+            }
+            ( *_answer )[ 0 ] = start;
+            
+            _stats.on_path( _answer -> size() );
+            
+            return this -> shared_from_this();
+          }
+          
+          // one pass text parser.
+          // single byte cell strings are compared at once, the others match the longest cell string.
+          auto parse_text( const char* const begin, const char* const end ) const
+            -> shared_data_t
+          {
+            const std::array< const std::string*, 4 > strings
+              {{ &_block_cell_string, &_road_cell_string, &_start_cell_string, &_goal_cell_string }};
+            
+            const std::array< std::uint8_t, 4 > values
+              {{ cell_type::block, cell_type::road, cell_type::start, cell_type::goal }};
+            
+            auto single_byte = true;
+            
+            for ( std::size_t k = 0; k < strings.size(); ++k )
+            {
+              if ( strings[ k ] -> empty() )
+                throw std::runtime_error( "cell string is empty." );
+              
+              if ( strings[ k ] -> size() != 1 )
+                single_byte = false;
+              
+              for ( std::size_t j = 0; j < k; ++j )
+                if ( *strings[ j ] == *strings[ k ] )
+                  throw std::runtime_error( "cell strings are not unique." );
+            }
+            
+            const auto c0 = ( *strings[ 0 ] )[ 0 ], c1 = ( *strings[ 1 ] )[ 0 ], c2 = ( *strings[ 2 ] )[ 0 ], c3 = ( *strings[ 3 ] )[ 0 ];
+            const auto v0 = values[ 0 ], v1 = values[ 1 ], v2 = values[ 2 ], v3 = values[ 3 ];
+            
+            std::array< std::size_t, 4 > order {{ 0, 1, 2, 3 }};
+            std::stable_sort
+            ( order.begin(), order.end()
+            , [ &strings ]( const std::size_t a, const std::size_t b )
+              { return strings[ a ] -> size() > strings[ b ] -> size(); }
+            );
+            
+            // a cell is at least 1 byte
+            std::vector< std::uint8_t > cells( std::size_t( end - begin ) );
+            
+            std::size_t n = 0, width = 0, height = 0;
+            bool empty_row = false;
+            
+            for ( auto p = begin; p < end; )
+            {
+              auto eol = static_cast< const char* >( std::memchr( p, '\n', std::size_t( end - p ) ) );
+              if ( not eol )
+                eol = end;
+              
+              auto row_end = eol;
+              if ( row_end > p and row_end[ -1 ] == '\r' )
+                --row_end;
+              
+              const auto row_begin = n;
+              
+              if ( row_end == p )
+                empty_row = true;
+              else
+              {
+                // empty rows are allowed only at the end
+                if ( empty_row )
+                  throw std::runtime_error( "maze text has an empty row." );
+                
+                if ( single_byte )
+                {
+                  // branchless compare and select, it is vectorized with -O3
+                  const auto length = std::size_t( row_end - p );
+                  const auto out    = cells.data() + n;
+                  
+                  std::uint8_t invalid = 0;
+                  
+                  for ( std::size_t i = 0; i < length; ++i )
+                  {
+                    const auto c = p[ i ];
+                    
+                    const auto m0 = std::uint8_t( -std::uint8_t( c == c0 ) );
+                    const auto m1 = std::uint8_t( -std::uint8_t( c == c1 ) );
+                    const auto m2 = std::uint8_t( -std::uint8_t( c == c2 ) );
+                    const auto m3 = std::uint8_t( -std::uint8_t( c == c3 ) );
+                    
+                    out[ i ] = std::uint8_t( ( m0 & v0 ) | ( m1 & v1 ) | ( m2 & v2 ) | ( m3 & v3 ) );
+                    invalid |= std::uint8_t( ~( m0 | m1 | m2 | m3 ) );
+                  }
+                  
+                  if ( invalid )
+                    throw std::runtime_error( "maze text has an unknown cell string." );
+                  
+                  n += length;
+                }
+                else
+                  for ( auto q = p; q < row_end; )
+                  {
+                    auto matched = false;
+                    
+                    for ( const auto k : order )
+                    {
+                      const auto& t = *strings[ k ];
+                      
+                      if ( std::size_t( row_end - q ) >= t.size() and std::memcmp( q, t.data(), t.size() ) == 0 )
+                      {
+                        cells[ n++ ] = values[ k ];
+                        q += t.size();
+                        matched = true;
+                        break;
+                      }
+                    }
+                    
+                    if ( not matched )
+                      throw std::runtime_error( "maze text has an unknown cell string." );
+                  }
+                
+                if ( height == 0 )
+                  width = n - row_begin;
+                else if ( n - row_begin != width )
+                  throw std::runtime_error( "maze data cols is not constant size." );
+                
+                ++height;
+              }
+              
+              p = eol == end ? end : eol + 1;
+            }
+            
+            if ( height == 0 )
+              throw std::runtime_error( "maze data rows is empty." );
+            
+            cells.resize( n );
+            
+            return std::make_shared< data_t >( data_t::adopt( size_t( width ), size_t( height ), std::move( cells ) ) );
+          }
+          
         public:
           
           solver_2d_t()
             : _full_gamut( false )
             , _directions( generate_directions< coordinate_t >() )
             , _algorithm( solver::algorithm::dijkstra )
+            , _block_cell_string   ( std::to_string( cell_type::block ) )
+            , _road_cell_string    ( std::to_string( cell_type::road  ) )
+            , _start_cell_string   ( u8"S" )
+            , _goal_cell_string    ( u8"G" )
           { }
           
           auto algorithm( const solver::algorithm a )
@@ -117,183 +495,182 @@ namespace wonder_rabbit_project
             return this -> shared_from_this();
           }
           
-          auto load( std::istream& s )
+          auto block_cell_string( const std::string s )
             -> shared_t
           {
-            throw std::logic_error( "not impl yet." );
+            _block_cell_string = s;
             return this -> shared_from_this();
           }
           
-          auto load( const std::string& t )
+          auto road_cell_string( const std::string s )
             -> shared_t
           {
-            throw std::logic_error( "not impl yet." );
+            _road_cell_string = s;
             return this -> shared_from_this();
           }
           
+          auto start_cell_string( const std::string s )
+            -> shared_t
+          {
+            _start_cell_string = s;
+            return this -> shared_from_this();
+          }
+          
+          auto goal_cell_string( const std::string s )
+            -> shared_t
+          {
+            _goal_cell_string = s;
+            return this -> shared_from_this();
+          }
+          
+          // the text of generator_2d_t::to_string() with the cell strings of this solver
+          auto load( std::istream& s )
+            -> shared_t
+          {
+            std::string buffer;
+            
+            // reserve the rest of a seekable stream
+            const auto from = s.tellg();
+            if ( from != std::streampos( -1 ) )
+            {
+              if ( s.seekg( 0, std::ios::end ) )
+              {
+                const auto to = s.tellg();
+                if ( to > from )
+                  buffer.reserve( std::size_t( to - from ) );
+              }
+              s.clear();
+              s.seekg( from );
+            }
+            
+            constexpr auto chunk_size = std::size_t( 1 ) << 20;
+            
+            for ( ;; )
+            {
+              const auto size = buffer.size();
+              buffer.resize( size + chunk_size );
+              s.read( &buffer[ size ], chunk_size );
+              const auto read_size = std::size_t( s.gcount() );
+              buffer.resize( size + read_size );
+              if ( read_size < chunk_size )
+                break;
+            }
+            
+            return load( parse_text( buffer.data(), buffer.data() + buffer.size() ) );
+          }
+          
+          // the text of generator_2d_t::to_string() with the cell strings of this solver
+          auto load( const std::string& t )
+            -> shared_t
+          { return load( parse_text( t.data(), t.data() + t.size() ) ); }
+          
+          // the binary of grid_2d_t::write_binary(), mapped and solved without copying the cells
+          auto load_binary( const std::string& path )
+            -> shared_t
+          { return load( data_t::map_binary( path ) ); }
+          
           auto load( const shared_data_t d )
             -> shared_t
           {
             if ( not d )
               throw std::runtime_error( "maze data is null." );
             
-            if ( d -> empty() )
+            if ( d -> height() == 0 )
               throw std::runtime_error( "maze data rows is empty." );
             
-            if ( d -> cbegin() -> empty() )
+            if ( d -> width() == 0 )
               throw std::runtime_error( "maze data cols is empty." );
             
             _maze   = d;
             
-            _width  = d -> cbegin() -> size();
-            _height = d -> size();
-            
-            for ( auto row = _maze -> cbegin() + 1; row != _maze -> cend(); ++row )
-              if ( _width != row -> size() )
-                throw std::runtime_error( "maze data cols is not constant size." );
+            _width  = d -> width();
+            _height = d -> height();
             
             return this -> shared_from_this();
           }
           
-          auto solve( )
+          // releases the maze data, the search buffers are kept for the next load()
+          auto unload( )
             -> shared_t
           {
-            struct vertex_data_t
-            {
-              size_t       distance;
-              coordinate_t previous;
-            };
-            
-            std::vector< std::vector< boost::optional< vertex_data_t > > > data
-              ( _maze -> size()
-              , std::vector< boost::optional< vertex_data_t > >
-                ( (*_maze)[0].size()
-                )
-              );
+            _maze.reset();
+            return this -> shared_from_this();
+          }
+          
+          // adapter for the old nested vector data
+          auto load( const shared_nested_data_t d )
+            -> shared_t
+          {
+            if ( not d )
+              throw std::runtime_error( "maze data is null." );
             
-            std::function< auto ( const coordinate_t& p ) -> void > search;
+            return load( std::make_shared< data_t >( data_t::from_nested( *d ) ) );
+          }
+          
+          auto solve( )
+            -> shared_t
+          {
+            if ( not _maze )
+              throw std::runtime_error( "maze data is not loaded." );
             
             coordinate_t start, goal;
             
-            std::function< auto ( const coordinate_t& p, const coordinate_t& np ) -> size_t > distance;
+            _stats.reset();
             
             switch( _algorithm )
             { case solver::algorithm::dijkstra:
-                solve_find_cell( &start, nullptr );
-                distance = [&]( const coordinate_t& p, const coordinate_t&)
-                  {
-                    return data[ p.y ][ p.x ] -> distance + 1;
-                    //const auto delta = np - start;
-                    //return std::abs( delta.x ) + std::abs( delta.y );
-                  };
-                break;
+                {
+                  const auto timer = _stats.timer( maze::stats::phase::find_cells );
+                  solve_find_cell( &start, nullptr );
+                }
+                return search( start, nullptr );
                 
               case solver::algorithm::a_star:
-                solve_find_cell( &start, &goal );
-                distance = [&]( const coordinate_t&, const coordinate_t& np )
-                  {
-                    const auto delta = np - goal;
-                    return std::abs( delta.x ) + std::abs( delta.y );
-                  };
-                break;
-                
-              default:
-                throw std::runtime_error("invalid algorithm");
-            };
-            
-            std::priority_queue
-              < coordinate_t
-              , std::vector< coordinate_t >
-              , std::function< auto ( const coordinate_t&, const coordinate_t& ) -> bool >
-              >
-              search_queue
-                ( [&]( const coordinate_t& a, const coordinate_t& b )
-                  { return distance( data[ a.y ][ a.x ] -> previous, a ) > distance( data[ b.y ][ b.x ] -> previous, b ); }
-                )
-              ;
-            
-            bool path_finded = false;
-            
-            search = [ & ]( const coordinate_t& p )
-            {
-              
-              for ( const auto& direction : _directions )
-              {
-                const auto np = p + direction;
-                
-                if ( np.x < 0
-                  or np.y < 0
-                  or np.x >= _width
-                  or np.y >= _height
-                  or not road( (*_maze)[ np.y ][ np.x ] )
-                )
-                  continue;
-                
-                auto d = distance( p, np );
-                
-                auto next_cell = data[ np.y ][ np.x ];
-                
-                if ( next_cell && next_cell -> distance <= d )
-                  continue;
-                
-                data[ np.y ][ np.x ] = { d, p };
-                
-                if ( maze::goal( (*_maze)[ np.y ][ np.x ] ) )
                 {
-                  goal = np;
-                  path_finded = true;
-                  if ( not _full_gamut )
-                    return;
+                  const auto timer = _stats.timer( maze::stats::phase::find_cells );
+                  solve_find_cell( &start, &goal );
                 }
+                return search( start, &goal );
                 
-                search_queue.push( np );
-              }
-              
-              while( not search_queue.empty() )
-              {
-                const auto np = search_queue.top();
-                search_queue.pop();
-                search( np );
-                
-                if ( path_finded and not _full_gamut )
-                  return;
-              }
-              
+              default:
+                throw std::runtime_error("invalid algorithm");
             };
+          }
+          
+          // solve between any two road cells, the start / goal cells in the maze data are not used.
+          auto solve( const coordinate_t& from, const coordinate_t& to )
+            -> shared_t
+          {
+            if ( not _maze )
+              throw std::runtime_error( "maze data is not loaded." );
             
-            data[ start.y ][ start.x ] = { 0, start };
-            search( start );
-            
-            _answer = std::make_shared< answer_t >();
+            for ( const auto& p : { from, to } )
+              if ( p.x < 0
+                or p.y < 0
+                or p.x >= _width
+                or p.y >= _height
+                or not road( _maze -> get( p ) )
+              )
+                throw std::runtime_error( "cell is not road." );
             
-            for ( auto cell = goal; cell != start; cell = data[ cell.y ][ cell.x ] -> previous )
-              _answer -> emplace_front( std::move( cell ) );
-            _answer -> emplace_front( std::move( start ) );
+            _stats.reset();
             
-            // for debug
-            /*
-            {
-              std::stringstream r;
-              for ( const auto data_raw : data )
-              {
-                for ( const auto data_cell : data_raw )
-                  if ( data_cell )
-                    r << std::min<char>( '@' + data_cell -> distance, 'Z' );
-                  else
-                    r << " ";
-                r << "\n";
-              }
-              std::cerr << r.str();
-            }
-            //*/
-            
-            return this -> shared_from_this();
+            return search( from, &to );
           }
           
+          auto data()
+            -> shared_data_t
+          { return _maze; }
+          
           auto answer()
             -> shared_answer_t
           { return _answer; }
           
+          // counters and timings of the last solve(); empty with stats::disabled_t
+          auto stats( ) const
+            -> const stats_t&
+          { return _stats; }
+          
           auto to_string()
             -> std::string
           {
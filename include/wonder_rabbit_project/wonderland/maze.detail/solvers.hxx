@@ -1,3 +1,4 @@
 #pragma once
 
 #include "solver_2d.hxx"
+#include "tree_index_2d.hxx"
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      // instrumentation policies of generator_2d_t and solver_2d_t.
+      //   disabled_t: the default; every hook is an empty inline function and is optimized away.
+      //   enabled_t : counts the hooks and times the phases of the last generate() / solve().
+      namespace stats
+      {
+        enum class phase
+        { generate
+        , find_cells
+        , search
+        , answer
+        };
+        
+        static constexpr auto phase_count = std::size_t( 4 );
+        
+        struct disabled_t
+        {
+          static constexpr bool enabled = false;
+          
+          // the empty destructor keeps the unused timer variables quiet
+          struct timer_t { ~timer_t( ) { } };
+          
+          auto reset( ) -> void { }
+          
+          // a node ( cell ) is expanded by a search or carved by a generator
+          auto on_expand( ) -> void { }
+          
+          // frontier: the size of the queue or the stack after the push
+          auto on_push( std::size_t ) -> void { }
+          auto on_pop( ) -> void { }
+          
+          auto on_path( std::size_t ) -> void { }
+          
+          // the phase is timed until the timer is destroyed
+          auto timer( phase ) -> timer_t { return timer_t(); }
+        };
+        
+        struct enabled_t
+        {
+          static constexpr bool enabled = true;
+          
+          using clock_t    = std::chrono::steady_clock;
+          using duration_t = std::chrono::nanoseconds;
+          
+          std::size_t expanded;
+          std::size_t pushes;
+          std::size_t pops;
+          std::size_t max_frontier;
+          std::size_t path_length;
+          
+          std::array< duration_t, phase_count > times;
+          
+          class timer_t
+          {
+            enabled_t*          _stats;
+            phase               _phase;
+            clock_t::time_point _begin;
+          
+          public:
+            
+            timer_t( enabled_t& s, const phase p )
+              : _stats( &s )
+              , _phase( p )
+              , _begin( clock_t::now() )
+            { }
+            
+            timer_t( timer_t&& t )
+              : _stats( t._stats )
+              , _phase( t._phase )
+              , _begin( t._begin )
+            { t._stats = nullptr; }
+            
+            timer_t( const timer_t& ) = delete;
+            auto operator=( const timer_t& ) -> timer_t& = delete;
+            
+            ~timer_t( )
+            {
+              if ( _stats )
+                _stats -> times[ std::size_t( _phase ) ]
+                  += std::chrono::duration_cast< duration_t >( clock_t::now() - _begin );
+            }
+          };
+          
+          enabled_t( )
+          { reset(); }
+          
+          auto reset( )
+            -> void
+          {
+            expanded     = 0;
+            pushes       = 0;
+            pops         = 0;
+            max_frontier = 0;
+            path_length  = 0;
+            times.fill( duration_t::zero() );
+          }
+          
+          auto on_expand( )
+            -> void
+          { ++expanded; }
+          
+          auto on_push( const std::size_t frontier )
+            -> void
+          {
+            ++pushes;
+            if ( frontier > max_frontier )
+              max_frontier = frontier;
+          }
+          
+          auto on_pop( )
+            -> void
+          { ++pops; }
+          
+          auto on_path( const std::size_t length )
+            -> void
+          { path_length = length; }
+          
+          auto timer( const phase p )
+            -> timer_t
+          { return timer_t( *this, p ); }
+          
+          auto time( const phase p ) const
+            -> duration_t
+          { return times[ std::size_t( p ) ]; }
+        };
+      }
+      
+      template < class T = void >
+      auto to_string( const stats::phase p )
+        -> std::string
+      {
+        switch( p )
+        { case stats::phase::generate  : return "generate";
+          case stats::phase::find_cells: return "find_cells";
+          case stats::phase::search    : return "search";
+          case stats::phase::answer    : return "answer";
+          default: throw std::runtime_error( "invalid phase." );
+        }
+      }
+    }
+  }
+}
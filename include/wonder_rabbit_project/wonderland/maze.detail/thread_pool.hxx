@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      // work stealing thread pool.
+      // each worker has its own deque: it pops its own tasks from the back,
+      // and steals from the front of the others when it is empty.
+      // a task receives the index of the worker running it, for per worker buffers.
+      class thread_pool_t
+      {
+      public:
+        using task_t = std::function< auto ( const std::size_t worker ) -> void >;
+      
+      private:
+        struct queue_t
+        {
+          std::mutex          mutex;
+          std::deque< task_t > tasks;
+        };
+        
+        std::vector< std::unique_ptr< queue_t > > _queues;
+        std::vector< std::thread >                _threads;
+        
+        std::mutex              _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        
+        // guarded by _mutex
+        std::size_t _queued;
+        std::size_t _pending;
+        std::size_t _next;
+        bool        _stop;
+        
+        std::exception_ptr _exception;
+        
+        auto try_pop( const std::size_t worker, task_t& task )
+          -> bool
+        {
+          const auto n = _queues.size();
+          
+          for ( std::size_t k = 0; k < n; ++k )
+          {
+            auto& q = *_queues[ ( worker + k ) % n ];
+            
+            std::lock_guard< std::mutex > lock( q.mutex );
+            
+            if ( q.tasks.empty() )
+              continue;
+            
+            if ( k == 0 )
+            {
+              task = std::move( q.tasks.back() );
+              q.tasks.pop_back();
+            }
+            else
+            {
+              task = std::move( q.tasks.front() );
+              q.tasks.pop_front();
+            }
+            
+            std::lock_guard< std::mutex > counter_lock( _mutex );
+            --_queued;
+            
+            return true;
+          }
+          
+          return false;
+        }
+        
+        auto run( const std::size_t worker )
+          -> void
+        {
+          for ( ;; )
+          {
+            task_t task;
+            
+            if ( try_pop( worker, task ) )
+            {
+              try
+              { task( worker ); }
+              catch ( ... )
+              {
+                std::lock_guard< std::mutex > lock( _mutex );
+                if ( not _exception )
+                  _exception = std::current_exception();
+              }
+              
+              std::lock_guard< std::mutex > lock( _mutex );
+              if ( --_pending == 0 )
+                _done.notify_all();
+              
+              continue;
+            }
+            
+            std::unique_lock< std::mutex > lock( _mutex );
+            
+            _wake.wait( lock, [ this ]{ return _stop or _queued > 0; } );
+            
+            if ( _stop )
+              return;
+          }
+        }
+      
+      public:
+        
+        explicit thread_pool_t( std::size_t threads = 0 )
+          : _queued( 0 )
+          , _pending( 0 )
+          , _next( 0 )
+          , _stop( false )
+        {
+          if ( threads == 0 )
+            threads = std::max( std::thread::hardware_concurrency(), 1u );
+          
+          for ( std::size_t n = 0; n < threads; ++n )
+            _queues.emplace_back( new queue_t );
+          
+          for ( std::size_t n = 0; n < threads; ++n )
+            _threads.emplace_back( [ this, n ]{ run( n ); } );
+        }
+        
+        thread_pool_t( const thread_pool_t& ) = delete;
+        auto operator=( const thread_pool_t& ) -> thread_pool_t& = delete;
+        
+        ~thread_pool_t( )
+        {
+          {
+            std::lock_guard< std::mutex > lock( _mutex );
+            _stop = true;
+          }
+          
+          _wake.notify_all();
+          
+          for ( auto& t : _threads )
+            t.join();
+        }
+        
+        auto size( ) const
+          -> std::size_t
+        { return _threads.size(); }
+        
+        // queued to the workers in round robin
+        auto submit( task_t task )
+          -> void
+        {
+          std::size_t worker;
+          {
+            std::lock_guard< std::mutex > lock( _mutex );
+            worker = _next++ % _queues.size();
+          }
+          submit( worker, std::move( task ) );
+        }
+        
+        // queued to the back of the worker's own deque; e.g. from a task to itself
+        auto submit( const std::size_t worker, task_t task )
+          -> void
+        {
+          // pending first: the task may finish before it is counted as queued
+          {
+            std::lock_guard< std::mutex > lock( _mutex );
+            ++_pending;
+          }
+          {
+            // the same lock order as try_pop: the queue, then the counters
+            auto& q = *_queues[ worker % _queues.size() ];
+            std::lock_guard< std::mutex > lock( q.mutex );
+            q.tasks.emplace_back( std::move( task ) );
+            
+            std::lock_guard< std::mutex > counter_lock( _mutex );
+            ++_queued;
+          }
+          _wake.notify_one();
+        }
+        
+        // waits for all the submitted tasks, and rethrows the first exception of them
+        auto wait( )
+          -> void
+        {
+          std::unique_lock< std::mutex > lock( _mutex );
+          
+          _done.wait( lock, [ this ]{ return _pending == 0; } );
+          
+          if ( _exception )
+          {
+            auto e = _exception;
+            _exception = nullptr;
+            std::rethrow_exception( e );
+          }
+        }
+      };
+    }
+  }
+}
@@ -2,6 +2,12 @@
 
 #include <cstdint>
 #include <type_traits>
+#include <array>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 #include <glm/glm.hpp>
 
 namespace wonder_rabbit_project
@@ -48,6 +54,59 @@ namespace wonder_rabbit_project
         return r;
       }
       
+      // all permutations of the direction indices [ 0, N ) ( 24 for 2d )
+      template < std::size_t N >
+      static inline auto generate_direction_permutations( )
+        -> std::vector< std::array< std::uint8_t, N > >
+      {
+        std::size_t count = 1;
+        for ( std::size_t n = 2; n <= N; ++n )
+          count *= n;
+        
+        std::vector< std::array< std::uint8_t, N > > r( count );
+        
+        // decode the k-th permutation in lexicographic order from its factorial number
+        for ( std::size_t k = 0; k < count; ++k )
+        {
+          std::vector< std::uint8_t > pool( N );
+          std::iota( pool.begin(), pool.end(), 0 );
+          
+          auto rest  = k;
+          auto block = count;
+          
+          for ( std::size_t n = 0; n < N; ++n )
+          {
+            block /= N - n;
+            const auto i = rest / block;
+            rest %= block;
+            r[ k ][ n ] = pool[ i ];
+            pool.erase( pool.begin() + i );
+          }
+        }
+        
+        return r;
+      }
+      
+      // n-th output of the SplitMix64 sequence from seed; independent seeds for each job, tile, ...
+      static inline auto split_mix_64( const std::uint64_t seed, const std::uint64_t n = 0 )
+        -> std::uint64_t
+      {
+        auto z = seed + ( n + 1 ) * UINT64_C( 0x9E3779B97F4A7C15 );
+        z = ( z ^ ( z >> 30 ) ) * UINT64_C( 0xBF58476D1CE4E5B9 );
+        z = ( z ^ ( z >> 27 ) ) * UINT64_C( 0x94D049BB133111EB );
+        return z ^ ( z >> 31 );
+      }
+      
+      static constexpr auto bit_width( const std::uint64_t n )
+        -> std::size_t
+      { return n == 0 ? 0 : 1 + bit_width( n >> 1 ); }
+      
+      // the count of the uniform low bits of ( draw - min ) of an engine with range = max - min:
+      // floor( log2( range + 1 ) ), e.g. 24 for std::ranlux24, 30 for std::minstd_rand, 64 for std::mt19937_64
+      static constexpr auto uniform_bits( const std::uint64_t range )
+        -> std::size_t
+      { return bit_width( range ) - ( ( range & ( range + 1 ) ) == 0 ? 0 : 1 ); }
+      
       template< class T_from >
       using to_glm_vec2_t =
         typename std::conditional
@@ -80,10 +139,19 @@ namespace wonder_rabbit_project
       //template < class T >
       //using voxel_maze_2d_t = std::vector< std::vector< T > >;
       
+      // cell storage of grid_2d_t
+      //   byte: 1 byte per cell, any cell_type value
+      //   bit : 1 bit  per cell ( road or block ), start and goal are kept as coordinates
+      enum class packing
+      { byte
+      , bit
+      };
+      
       namespace generator
       {
         enum class algorithm
         { drill
+        , eller
         };
       }
       
@@ -93,6 +161,7 @@ namespace wonder_rabbit_project
       {
         switch( a )
         { case generator::algorithm::drill: return "Drill";
+          case generator::algorithm::eller: return "Eller";
           default: throw std::runtime_error( "invalid algorithm." );
         }
       }
@@ -0,0 +1,402 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "traits.hxx"
+#include "grid_2d.hxx"
+#include "solver_2d.hxx"
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      namespace solver
+      {
+        // precomputed index for many point to point queries on one maze.
+        // a perfect maze ( the road cells are a spanning tree ) is indexed with an euler tour
+        // and a sparse table over its blocks for the LCA:
+        //   distance( a, b ) : O( block_size )
+        //   path    ( a, b ) : O( path length )
+        // the other mazes ( cycles or not connected ) fall back to solver_2d_t.
+        // the queries may run concurrently: the tree queries only read the index,
+        // the fallback queries share one solver and run one at a time.
+        template
+        < class T_size = std::int_fast32_t
+        >
+        class tree_index_2d_t
+          : public std::enable_shared_from_this< tree_index_2d_t< T_size > >
+        {
+        public:
+          using size_t = T_size;
+          
+          using shared_t = std::shared_ptr< tree_index_2d_t< T_size > >;
+          
+          using solver_t = solver_2d_t< size_t >;
+          
+          using coordinate_t    = typename solver_t::coordinate_t;
+          using data_t          = typename solver_t::data_t;
+          using shared_data_t   = typename solver_t::shared_data_t;
+          using answer_t        = typename solver_t::answer_t;
+          using shared_answer_t = typename solver_t::shared_answer_t;
+          
+          static constexpr auto block_size = std::size_t( 32 );
+        
+        private:
+          using node_t = std::uint32_t;
+          
+          static constexpr auto no_node   = std::numeric_limits< node_t >::max();
+          static constexpr auto no_parent = std::uint8_t( 0xFF );
+          
+          shared_data_t _maze;
+          
+          size_t _width;
+          size_t _height;
+          
+          bool _tree;
+          
+          const std::vector< coordinate_t > _directions;
+          
+          // per cell: direction index from the parent, depth from the root, first euler tour index
+          std::vector< std::uint8_t > _parent;
+          std::vector< node_t >       _depth;
+          std::vector< node_t >       _first;
+          
+          std::vector< node_t > _euler;
+          
+          // _sparse[ k ][ b ]: euler index of the shallowest node in the blocks [ b, b + 2^k )
+          std::vector< std::vector< node_t > > _sparse;
+          
+          std::vector< std::uint8_t > _stack;
+          
+          typename solver_t::shared_t _solver;
+          
+          // guards the buffers of _solver in the const fallback queries
+          mutable std::mutex _solver_mutex;
+          
+          auto index( const coordinate_t& p ) const
+            -> std::size_t
+          { return std::size_t( p.y ) * std::size_t( _width ) + std::size_t( p.x ); }
+          
+          auto coordinate( const std::size_t i ) const
+            -> coordinate_t
+          { return coordinate_t( size_t( i % _width ), size_t( i / _width ) ); }
+          
+          auto in_range( const coordinate_t& p ) const
+            -> bool
+          { return p.x >= 0 and p.y >= 0 and p.x < _width and p.y < _height; }
+          
+          auto exception_if_not_road( const coordinate_t& p ) const
+            -> void
+          {
+            if ( not in_range( p ) or not road( _maze -> get( p ) ) )
+              throw std::runtime_error( "cell is not road." );
+          }
+          
+          auto shallower( const node_t a, const node_t b ) const
+            -> node_t
+          { return _depth[ _euler[ b ] ] < _depth[ _euler[ a ] ] ? b : a; }
+          
+          auto lca( const std::size_t a, const std::size_t b ) const
+            -> std::size_t
+          {
+            auto l = _first[ a ];
+            auto r = _first[ b ];
+            
+            if ( l > r )
+              std::swap( l, r );
+            
+            const auto lb = l / block_size;
+            const auto rb = r / block_size;
+            
+            auto best = l;
+            
+            if ( lb == rb )
+            {
+              for ( auto i = l + 1; i <= r; ++i )
+                best = shallower( best, i );
+              return _euler[ best ];
+            }
+            
+            for ( auto i = l + 1; i < ( lb + 1 ) * block_size; ++i )
+              best = shallower( best, i );
+            
+            for ( auto i = node_t( rb * block_size ); i <= r; ++i )
+              best = shallower( best, i );
+            
+            if ( lb + 1 < rb )
+            {
+              const auto from  = lb + 1;
+              const auto count = rb - from;
+              
+              std::size_t k = 0;
+              while ( ( std::size_t( 2 ) << k ) <= count )
+                ++k;
+              
+              best = shallower( best, _sparse[ k ][ from ] );
+              best = shallower( best, _sparse[ k ][ rb - ( std::size_t( 1 ) << k ) ] );
+            }
+            
+            return _euler[ best ];
+          }
+          
+          // iterative DFS from root. returns false if a road cell is reached twice ( a cycle ).
+          auto build_euler_tour( const std::size_t root )
+            -> bool
+          {
+            _euler.push_back( node_t( root ) );
+            _first [ root ] = 0;
+            _depth [ root ] = 0;
+            _parent[ root ] = no_parent;
+            
+            auto cell = root;
+            
+            _stack.clear();
+            _stack.push_back( 0 );
+            
+            while ( not _stack.empty() )
+            {
+              const auto step = _stack.back();
+              
+              if ( step == _directions.size() )
+              {
+                _stack.pop_back();
+                
+                if ( not _stack.empty() )
+                {
+                  cell = index( coordinate( cell ) - _directions[ _parent[ cell ] ] );
+                  _euler.push_back( node_t( cell ) );
+                }
+                
+                continue;
+              }
+              
+              ++_stack.back();
+              
+              // do not go back to the parent
+              if ( _parent[ cell ] != no_parent and ( _parent[ cell ] ^ 1 ) == step )
+                continue;
+              
+              const auto np = coordinate( cell ) + _directions[ step ];
+              
+              if ( not in_range( np ) or not road( _maze -> get( np ) ) )
+                continue;
+              
+              const auto next = index( np );
+              
+              if ( _depth[ next ] != no_node )
+                return false;
+              
+              _parent[ next ] = step;
+              _depth [ next ] = _depth[ cell ] + 1;
+              _first [ next ] = node_t( _euler.size() );
+              _euler.push_back( node_t( next ) );
+              
+              cell = next;
+              _stack.push_back( 0 );
+            }
+            
+            return true;
+          }
+          
+          auto build_sparse_table( )
+            -> void
+          {
+            const auto blocks = ( _euler.size() + block_size - 1 ) / block_size;
+            
+            _sparse.assign( 1, std::vector< node_t >( blocks ) );
+            
+            for ( std::size_t b = 0; b < blocks; ++b )
+            {
+              auto best = node_t( b * block_size );
+              const auto end = std::min( ( b + 1 ) * block_size, _euler.size() );
+              for ( auto i = best + 1; i < end; ++i )
+                best = shallower( best, i );
+              _sparse[ 0 ][ b ] = best;
+            }
+            
+            for ( std::size_t k = 1; ( std::size_t( 1 ) << k ) <= blocks; ++k )
+            {
+              const auto half  = std::size_t( 1 ) << ( k - 1 );
+              const auto count = blocks - ( std::size_t( 1 ) << k ) + 1;
+              
+              _sparse.emplace_back( count );
+              
+              for ( std::size_t b = 0; b < count; ++b )
+                _sparse[ k ][ b ] = shallower( _sparse[ k - 1 ][ b ], _sparse[ k - 1 ][ b + half ] );
+            }
+          }
+        
+        public:
+          
+          tree_index_2d_t()
+            : _tree( false )
+            , _directions( generate_directions< coordinate_t >() )
+          { }
+          
+          auto load( const shared_data_t d )
+            -> shared_t
+          {
+            if ( not d )
+              throw std::runtime_error( "maze data is null." );
+            
+            if ( d -> height() == 0 )
+              throw std::runtime_error( "maze data rows is empty." );
+            
+            if ( d -> width() == 0 )
+              throw std::runtime_error( "maze data cols is empty." );
+            
+            const auto cells = std::size_t( d -> width() ) * std::size_t( d -> height() );
+            
+            if ( cells >= no_node )
+              throw std::runtime_error( "maze data is too large for tree index." );
+            
+            _maze   = d;
+            _width  = d -> width();
+            _height = d -> height();
+            
+            _tree = false;
+            _solver.reset();
+            _euler.clear();
+            _sparse.clear();
+            
+            // a tree has ( edges == roads - 1 ) and is connected
+            std::size_t roads = 0, edges = 0, root = cells;
+            
+            for ( size_t y = 0; y < _height; ++y )
+              for ( size_t x = 0; x < _width; ++x )
+              {
+                if ( not road( _maze -> get( x, y ) ) )
+                  continue;
+                
+                if ( roads++ == 0 )
+                  root = index( coordinate_t( x, y ) );
+                
+                if ( x + 1 < _width and road( _maze -> get( x + 1, y ) ) )
+                  ++edges;
+                
+                if ( y + 1 < _height and road( _maze -> get( x, y + 1 ) ) )
+                  ++edges;
+              }
+            
+            if ( roads > 0 and edges + 1 == roads )
+            {
+              _parent.assign( cells, std::uint8_t( no_parent ) );
+              _depth .assign( cells, node_t( no_node ) );
+              _first .assign( cells, node_t( no_node ) );
+              
+              _euler.reserve( roads * 2 - 1 );
+              _stack.reserve( roads );
+              
+              _tree = build_euler_tour( root ) and _euler.size() == roads * 2 - 1;
+            }
+            
+            if ( _tree )
+              build_sparse_table();
+            else
+            {
+              _parent.clear(); _parent.shrink_to_fit();
+              _depth .clear(); _depth .shrink_to_fit();
+              _first .clear(); _first .shrink_to_fit();
+              _euler .clear(); _euler .shrink_to_fit();
+              
+              _solver = std::make_shared< solver_t >();
+              _solver -> load( d );
+            }
+            
+            return this -> shared_from_this();
+          }
+          
+          // true if the loaded maze is a tree and the queries use the index
+          auto tree( ) const
+            -> bool
+          { return _tree; }
+          
+          // solver for the fallback; e.g. to choose the algorithm before the queries.
+          // it is not guarded: do not use it while queries are running.
+          auto solver( ) const
+            -> typename solver_t::shared_t
+          { return _solver; }
+          
+          auto distance( const coordinate_t& a, const coordinate_t& b ) const
+            -> size_t
+          {
+            if ( not _maze )
+              throw std::runtime_error( "maze data is not loaded." );
+            
+            if ( not _tree )
+            {
+              std::lock_guard< std::mutex > lock( _solver_mutex );
+              return size_t( _solver -> solve( a, b ) -> answer() -> size() - 1 );
+            }
+            
+            exception_if_not_road( a );
+            exception_if_not_road( b );
+            
+            const auto ia = index( a );
+            const auto ib = index( b );
+            
+            return size_t( _depth[ ia ] + _depth[ ib ] - 2 * _depth[ lca( ia, ib ) ] );
+          }
+          
+          // the same answer_t as solver_2d_t: a, ..., b
+          auto path( const coordinate_t& a, const coordinate_t& b ) const
+            -> shared_answer_t
+          {
+            if ( not _maze )
+              throw std::runtime_error( "maze data is not loaded." );
+            
+            if ( not _tree )
+            {
+              std::lock_guard< std::mutex > lock( _solver_mutex );
+              return std::make_shared< answer_t >( *_solver -> solve( a, b ) -> answer() );
+            }
+            
+            exception_if_not_road( a );
+            exception_if_not_road( b );
+            
+            const auto ia = index( a );
+            const auto ib = index( b );
+            const auto ic = lca( ia, ib );
+            
+            auto r = std::make_shared< answer_t >();
+            
+            // a -> lca
+            auto p = a;
+            r -> emplace_back( p );
+            for ( auto i = ia; i != ic; i = index( p ) )
+            {
+              p -= _directions[ _parent[ i ] ];
+              r -> emplace_back( p );
+            }
+            
+            // lca -> b, filled from b backwards
+            const auto half = std::size_t( _depth[ ib ] - _depth[ ic ] );
+            const auto base = r -> size();
+            
+            r -> resize( base + half );
+            
+            p = b;
+            for ( auto n = half; n > 0; --n )
+            {
+              ( *r )[ base + n - 1 ] = p;
+              p -= _directions[ _parent[ index( p ) ] ];
+            }
+            
+            return r;
+          }
+        };
+      }
+    }
+  }
+}
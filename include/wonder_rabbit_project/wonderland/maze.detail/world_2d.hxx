@@ -0,0 +1,578 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "traits.hxx"
+#include "thread_pool.hxx"
+#include "generator_2d.hxx"
+#include "solver_2d.hxx"
+
+namespace wonder_rabbit_project
+{
+  namespace wonderland
+  {
+    namespace maze
+    {
+      // a maze world of tiles, generated on demand and kept in a bounded LRU cache.
+      //
+      // the world covers the quadrant x >= 0, y >= 0 ( optionally bounded in tiles ).
+      // a tile has tile_size x tile_size cells, ( tile_size * 2 ) pixels on a side:
+      // it is generated by generator_2d_t with the size ( tile_size * 2 + 1 ), and keeps
+      // the pixels [ 0, tile_size * 2 ); its own west and north walls, not the east and south ones.
+      //
+      // the tiles are linked into a spanning tree: a tile opens its own west or north wall
+      // to the parent tile, chosen by a hash of the tile ( the west column links north,
+      // the north row links west, the tile ( 0, 0 ) is the root ). each tile is a perfect maze,
+      // so the whole world is a single perfect maze.
+      //
+      // everything in a tile is derived from split_mix_64 of the world seed and the tile coordinate,
+      // an evicted tile is generated again with the same contents.
+      template
+      < class T_rng  = std::conditional< sizeof( void* ) == 8, std::mt19937_64  , std::mt19937      >::type
+      , class T_size = std::int_fast32_t
+      >
+      class world_2d_t
+        : public std::enable_shared_from_this
+          < world_2d_t
+            < T_rng
+            , T_size
+            >
+          >
+      {
+      public:
+        using rng_t  = T_rng;
+        using size_t = T_size;
+        
+        using shared_t = std::shared_ptr< world_2d_t >;
+        
+        using generator_t = generator::generator_2d_t< rng_t, size_t >;
+        using solver_t    = solver::solver_2d_t< size_t >;
+        
+        using coordinate_t    = typename generator_t::coordinate_t;
+        using data_t          = typename generator_t::data_t;
+        using shared_data_t   = typename generator_t::shared_data_t;
+        using answer_t        = typename solver_t::answer_t;
+        using shared_answer_t = typename solver_t::shared_answer_t;
+        
+        static constexpr auto default_tile_size  = size_t( 32 );
+        static constexpr auto default_cache_size = std::size_t( 256 );
+      
+      private:
+        // the settings are shared with the generation jobs and replaced, not changed
+        struct config_t
+        {
+          size_t               tile_size;
+          size_t               tiles_x;
+          size_t               tiles_y;
+          std::uint64_t        seed;
+          generator::algorithm algorithm;
+          maze::packing        packing;
+        };
+        
+        using shared_config_t = std::shared_ptr< const config_t >;
+        
+        // a tile is generated by the first of the pool and a lookup to claim the job
+        struct job_t
+        {
+          shared_config_t                 config;
+          coordinate_t                    tile;
+          std::promise< shared_data_t >   promise;
+          std::atomic< bool >             claimed;
+          
+          job_t( const shared_config_t& c, const coordinate_t& t )
+            : config( c )
+            , tile( t )
+            , claimed( false )
+          { }
+        };
+        
+        using key_t = std::pair< size_t, size_t >;
+        
+        struct key_hash_t
+        {
+          auto operator()( const key_t& k ) const
+            -> std::size_t
+          { return std::size_t( split_mix_64( std::uint64_t( k.first ), std::uint64_t( k.second ) ) ); }
+        };
+        
+        struct entry_t
+        {
+          std::shared_future< shared_data_t >  tile;
+          std::shared_ptr< job_t >             job;
+          typename std::list< key_t >::iterator lru;
+        };
+        
+        shared_config_t _config;
+        
+        std::size_t _cache_size;
+        std::size_t _threads;
+        
+        solver::algorithm _solver_algorithm;
+        
+        std::mutex _mutex;
+        
+        // guarded by _mutex; the front of _lru is the most recently used
+        std::list< key_t >                                 _lru;
+        std::unordered_map< key_t, entry_t, key_hash_t >   _cache;
+        
+        std::unique_ptr< thread_pool_t > _pool;
+        
+        enum class link
+        { none
+        , west
+        , north
+        };
+        
+        static auto tile_key( const config_t& c, const coordinate_t& t )
+          -> std::uint64_t
+        { return split_mix_64( split_mix_64( c.seed, std::uint64_t( t.x ) ), std::uint64_t( t.y ) ); }
+        
+        // the parent link of a tile in the tile spanning tree
+        static auto link_of( const config_t& c, const coordinate_t& t )
+          -> link
+        {
+          if ( t.x == 0 and t.y == 0 )
+            return link::none;
+          
+          if ( t.x == 0 )
+            return link::north;
+          
+          if ( t.y == 0 )
+            return link::west;
+          
+          return ( split_mix_64( tile_key( c, t ), 1 ) & 1 ) ? link::west : link::north;
+        }
+        
+        static auto parent_of( const config_t& c, const coordinate_t& t )
+          -> coordinate_t
+        {
+          switch ( link_of( c, t ) )
+          { case link::west : return coordinate_t( t.x - 1, t.y );
+            case link::north: return coordinate_t( t.x, t.y - 1 );
+            default         : return t;
+          }
+        }
+        
+        // the odd offset of the opening in the tile's own west or north wall
+        static auto opening_of( const config_t& c, const coordinate_t& t )
+          -> size_t
+        { return size_t( 2 * ( split_mix_64( tile_key( c, t ), 2 ) % std::uint64_t( c.tile_size ) ) + 1 ); }
+        
+        static auto generate_tile( const config_t& c, const coordinate_t& t )
+          -> shared_data_t
+        {
+          auto rng = std::make_shared< rng_t >( typename rng_t::result_type( split_mix_64( tile_key( c, t ), 0 ) ) );
+          auto g   = std::make_shared< generator_t >();
+          
+          g -> rng( rng )
+            -> size( c.tile_size * 2 + 1 )
+            -> algorithm( c.algorithm )
+            -> packing( c.packing )
+            -> generate()
+            ;
+          
+          const auto d = g -> data();
+          
+          // start and goal are plain road cells in the world
+          for ( const auto& p : { d -> start_cell(), d -> goal_cell() } )
+            if ( p )
+              d -> set( *p, cell_type::road );
+          
+          switch ( link_of( c, t ) )
+          { case link::west : d -> set( 0, opening_of( c, t ), cell_type::road ); break;
+            case link::north: d -> set( opening_of( c, t ), 0, cell_type::road ); break;
+            default: ;
+          }
+          
+          return d;
+        }
+        
+        static auto run_job( job_t& job )
+          -> void
+        {
+          if ( job.claimed.exchange( true ) )
+            return;
+          
+          try
+          { job.promise.set_value( generate_tile( *job.config, job.tile ) ); }
+          catch ( ... )
+          { job.promise.set_exception( std::current_exception() ); }
+        }
+        
+        auto in_world( const config_t& c, const coordinate_t& t ) const
+          -> bool
+        {
+          return t.x >= 0
+             and t.y >= 0
+             and ( c.tiles_x == 0 or t.x < c.tiles_x )
+             and ( c.tiles_y == 0 or t.y < c.tiles_y )
+             ;
+        }
+        
+        // guarded by _mutex
+        auto evict( )
+          -> void
+        {
+          while ( _cache.size() > _cache_size )
+          {
+            _cache.erase( _lru.back() );
+            _lru.pop_back();
+          }
+        }
+        
+        // guarded by _mutex; the entry of the tile, a new job is returned if it is not cached
+        auto find_or_insert( const coordinate_t& t, std::shared_ptr< job_t >& new_job )
+          -> entry_t&
+        {
+          const key_t k( t.x, t.y );
+          
+          auto i = _cache.find( k );
+          
+          if ( i != _cache.end() )
+          {
+            _lru.splice( _lru.begin(), _lru, i -> second.lru );
+            return i -> second;
+          }
+          
+          new_job = std::make_shared< job_t >( _config, t );
+          
+          _lru.push_front( k );
+          
+          auto& e = _cache[ k ];
+          e.tile = new_job -> promise.get_future().share();
+          e.job  = new_job;
+          e.lru  = _lru.begin();
+          
+          evict();
+          
+          return _cache.find( k ) -> second;
+        }
+        
+        // the settings are replaced for the next tiles, the cached tiles are dropped
+        auto reconfigure( const config_t& c )
+          -> shared_t
+        {
+          std::lock_guard< std::mutex > lock( _mutex );
+          _config = std::make_shared< const config_t >( c );
+          _cache.clear();
+          _lru.clear();
+          return this -> shared_from_this();
+        }
+        
+        auto config( ) const
+          -> config_t
+        { return *_config; }
+      
+      public:
+        
+        world_2d_t( )
+          : _config
+            ( std::make_shared< const config_t >
+              ( config_t
+                { default_tile_size
+                , 0
+                , 0
+                , 0
+                , generator::algorithm::drill
+                , maze::packing::byte
+                }
+              )
+            )
+          , _cache_size( default_cache_size )
+          , _threads( 0 )
+          , _solver_algorithm( solver::algorithm::dijkstra )
+        { }
+        
+        world_2d_t( const world_2d_t& ) = delete;
+        auto operator=( const world_2d_t& ) -> world_2d_t& = delete;
+        
+        ~world_2d_t( )
+        {
+          // the queued jobs are claimed to be skipped by the pool
+          std::lock_guard< std::mutex > lock( _mutex );
+          for ( auto& e : _cache )
+            if ( e.second.job )
+              e.second.job -> claimed = true;
+        }
+        
+        // the settings drop the cached tiles; they are not synchronized with the lookups on other threads.
+        
+        // cells on a side of a tile
+        auto tile_size( const size_t n )
+          -> shared_t
+        {
+          if ( n < 1 )
+            throw std::runtime_error( "tile size is too small." );
+          auto c = config();
+          c.tile_size = n;
+          return reconfigure( c );
+        }
+        
+        // tiles of the world; 0 is unbounded
+        auto tiles( const size_t x, const size_t y )
+          -> shared_t
+        {
+          auto c = config();
+          c.tiles_x = x;
+          c.tiles_y = y;
+          return reconfigure( c );
+        }
+        
+        auto seed( const std::uint64_t s )
+          -> shared_t
+        {
+          auto c = config();
+          c.seed = s;
+          return reconfigure( c );
+        }
+        
+        auto generator_algorithm( const generator::algorithm a )
+          -> shared_t
+        {
+          auto c = config();
+          c.algorithm = a;
+          return reconfigure( c );
+        }
+        
+        auto packing( const maze::packing p )
+          -> shared_t
+        {
+          auto c = config();
+          c.packing = p;
+          return reconfigure( c );
+        }
+        
+        auto solver_algorithm( const solver::algorithm a )
+          -> shared_t
+        {
+          _solver_algorithm = a;
+          return this -> shared_from_this();
+        }
+        
+        // tiles in the cache
+        auto cache_size( const std::size_t n )
+          -> shared_t
+        {
+          if ( n < 1 )
+            throw std::runtime_error( "cache size is too small." );
+          
+          std::lock_guard< std::mutex > lock( _mutex );
+          _cache_size = n;
+          evict();
+          return this -> shared_from_this();
+        }
+        
+        // background generation threads, before the first prefetch(); 0: std::thread::hardware_concurrency()
+        auto threads( const std::size_t n )
+          -> shared_t
+        {
+          _threads = n;
+          return this -> shared_from_this();
+        }
+        
+        // pixels on a side of a tile
+        auto tile_pixels( ) const
+          -> size_t
+        { return _config -> tile_size * 2; }
+        
+        // tiles in the cache now
+        auto cached( )
+          -> std::size_t
+        {
+          std::lock_guard< std::mutex > lock( _mutex );
+          return _cache.size();
+        }
+        
+        auto tile_of( const coordinate_t& p ) const
+          -> coordinate_t
+        {
+          const auto n = tile_pixels();
+          return coordinate_t( p.x / n, p.y / n );
+        }
+        
+        auto origin_of( const coordinate_t& tile ) const
+          -> coordinate_t
+        {
+          const auto n = tile_pixels();
+          return coordinate_t( tile.x * n, tile.y * n );
+        }
+        
+        auto in_world( const coordinate_t& tile ) const
+          -> bool
+        { return in_world( *_config, tile ); }
+        
+        // the tile data of the size ( tile_pixels() + 1 ); the pixels of the last row and column are not of the tile.
+        // generated in this thread if it is not cached and not taken by the pool yet.
+        auto tile( const coordinate_t& t )
+          -> shared_data_t
+        {
+          if ( not in_world( t ) )
+            throw std::runtime_error( "tile is out of the world." );
+          
+          std::shared_future< shared_data_t > f;
+          std::shared_ptr< job_t > job;
+          
+          {
+            std::lock_guard< std::mutex > lock( _mutex );
+            auto& e = find_or_insert( t, job );
+            f   = e.tile;
+            job = e.job;
+          }
+          
+          run_job( *job );
+          
+          return f.get();
+        }
+        
+        // queues the tiles in the radius ( in tiles ) around the pixel to the background threads,
+        // the nearest first. the cached ones are marked as recently used.
+        auto prefetch( const coordinate_t& center, const size_t radius )
+          -> shared_t
+        {
+          const auto side = std::size_t( radius ) * 2 + 1;
+          
+          std::lock_guard< std::mutex > lock( _mutex );
+          
+          if ( side * side > _cache_size )
+            throw std::runtime_error( "prefetch area is larger than the cache." );
+          
+          if ( not _pool )
+            _pool.reset( new thread_pool_t( _threads ) );
+          
+          const auto c = tile_of( center );
+          
+          // the far rings first: the near tiles are the most recently used,
+          // and each worker pops its own latest tasks first
+          for ( auto k = radius + 1; k > 0; --k )
+          {
+            const auto r = k - 1;
+            
+            for ( auto y = c.y - r; y <= c.y + r; ++y )
+              for ( auto x = c.x - r; x <= c.x + r; ++x )
+              {
+                if ( std::max( std::abs( x - c.x ), std::abs( y - c.y ) ) != r )
+                  continue;
+                
+                const coordinate_t t( x, y );
+                
+                if ( not in_world( t ) )
+                  continue;
+                
+                std::shared_ptr< job_t > job;
+                find_or_insert( t, job );
+                
+                if ( job )
+                  _pool -> submit( [ job ]( const std::size_t ){ run_job( *job ); } );
+              }
+          }
+          
+          return this -> shared_from_this();
+        }
+        
+        // the pixel of the world; block out of the world
+        auto get( const coordinate_t& p )
+          -> std::uint8_t
+        {
+          const auto t = tile_of( p );
+          
+          if ( p.x < 0 or p.y < 0 or not in_world( t ) )
+            return cell_type::block;
+          
+          return tile( t ) -> get( p - origin_of( t ) );
+        }
+        
+        // the path between two road pixels through the tiles, the tiles are pulled through the cache.
+        // the tiles of the path are found on the tile tree first, then solved one by one between the openings.
+        auto solve( const coordinate_t& from, const coordinate_t& to )
+          -> shared_answer_t
+        {
+          for ( const auto& p : { from, to } )
+            if ( not road( get( p ) ) )
+              throw std::runtime_error( "cell is not road." );
+          
+          const auto c = _config;
+          
+          // up to the lowest common ancestor; the depth of a tile is ( x + y )
+          std::vector< coordinate_t > up_from( 1, tile_of( from ) );
+          std::vector< coordinate_t > up_to  ( 1, tile_of( to   ) );
+          
+          while ( up_from.back() != up_to.back() )
+            if ( up_from.back().x + up_from.back().y >= up_to.back().x + up_to.back().y )
+              up_from.push_back( parent_of( *c, up_from.back() ) );
+            else
+              up_to.push_back( parent_of( *c, up_to.back() ) );
+          
+          auto tiles = std::move( up_from );
+          tiles.insert( tiles.end(), up_to.rbegin() + 1, up_to.rend() );
+          
+          auto r = std::make_shared< answer_t >();
+          
+          const auto s = std::make_shared< solver_t >();
+          s -> algorithm( _solver_algorithm );
+          
+          const auto solve_in = [ this, &s, &r ]( const coordinate_t& t, const coordinate_t& a, const coordinate_t& b )
+          {
+            const auto o = origin_of( t );
+            
+            s -> load( tile( t ) ) -> solve( a - o, b - o );
+            
+            for ( const auto& p : *s -> answer() )
+              r -> emplace_back( p + o );
+          };
+          
+          auto current = from;
+          
+          for ( std::size_t n = 0; n + 1 < tiles.size(); ++n )
+          {
+            const auto& a = tiles[ n ];
+            const auto& b = tiles[ n + 1 ];
+            
+            // the opening is in the wall of the child tile
+            const auto up    = parent_of( *c, a ) == b;
+            const auto child = up ? a : b;
+            const auto o     = origin_of( child );
+            
+            coordinate_t gate, inward;
+            
+            if ( link_of( *c, child ) == link::west )
+            {
+              gate   = o + coordinate_t( 0, opening_of( *c, child ) );
+              inward = coordinate_t( 1, 0 );
+            }
+            else
+            {
+              gate   = o + coordinate_t( opening_of( *c, child ), 0 );
+              inward = coordinate_t( 0, 1 );
+            }
+            
+            const auto exit  = up ? gate + inward : gate - inward;
+            const auto entry = up ? gate - inward : gate + inward;
+            
+            solve_in( a, current, exit );
+            r -> emplace_back( gate );
+            
+            current = entry;
+          }
+          
+          solve_in( tiles.back(), current, to );
+          
+          return r;
+        }
+      };
+    }
+  }
+}
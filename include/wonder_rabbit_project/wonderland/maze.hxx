@@ -2,3 +2,5 @@
 
 #include "maze.detail/generators.hxx"
 #include "maze.detail/solvers.hxx"
+#include "maze.detail/batch_2d.hxx"
+#include "maze.detail/world_2d.hxx"